@@ -0,0 +1,21 @@
+#ifndef CLI_H
+#define CLI_H
+
+namespace BML {
+
+// Headless entry point:
+//   bml [--mods DIR] [--game DIR] [--profile FILE] install|restore|scan
+// The profile is a file or the name of one in ./Profiles, and folders default
+// to the ones saved by the window. --resolve adds the dependencies of the
+// profile's mods. Returns the compiler's result code, 11 for bad arguments,
+// 12 for a profile that cannot be used and 13 for dependencies that cannot be
+// met.
+int runCli(int argc, char *argv[]);
+
+// True if the first argument is a command or an option of runCli. Anything
+// else, such as Qt's -style or macOS's -psn_*, is left to the window.
+bool isCliCommand(int argc, char *argv[]);
+
+} // namespace BML
+
+#endif // CLI_H
@@ -1,36 +1,99 @@
 #ifndef COMPILER_H
 #define COMPILER_H
 
-#include "logger.h"
+#include "log.h"
+#include "manifest.h"
 #include "mod.h"
+#include "registry.h"
+#include "store.h"
+#include "threadpool.h"
+#include <atomic>
 #include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 
 namespace BML {
 
+// Staged copies every winning file into ./Staging and renames it into the game
+// folder. Direct writes it straight into the game folder through a temporary
+// file, halving the bytes written and the free space needed.
+enum class InstallMode { Staged, Direct };
+
 class Compiler {
 
 public:
-  Compiler(Logger *log);
-  Compiler(std::string path, Logger *log);
-  Compiler(std::vector<Mod> list, std::string path, Logger *log);
+  Compiler(Log *log);
+  Compiler(std::string path, Log *log);
+  Compiler(std::vector<Mod> list, std::string path, Log *log);
   ~Compiler();
 
   uint8_t compile();
-  void setModList(std::vector<Mod> mods);
+  // Put back every file the last install replaced or added
+  uint8_t restore();
+  void setModList(const std::vector<Mod> &mods);
   void setPath(std::string path);
+  void setInstallMode(InstallMode mode);
+
+  // Called from the compiling thread with files done, files total (0 while
+  // still unknown) and bytes processed so far, once for staging and once for
+  // injection
+  void setProgressCallback(
+      std::function<void(size_t, size_t, uintmax_t)> callback);
+  void cancel();
 
 private:
-  bool dependCheck(Mod mod);
-  bool incompatibleCheck(Mod mod);
-  bool stageMod(Mod mod);
+  bool dependCheck(const Mod &mod);
+  bool incompatibleCheck(const Mod &mod);
+  bool overlayMod(const Mod &mod);
+  bool stageOverlay();
   bool inject();
-  bool restoreSnapshot();
+  bool restoreSnapshot(const std::filesystem::path &folder);
+  bool restoreFile(const std::filesystem::path &folder,
+                   const std::string &relative);
+  // True if the game file holds content hash as the last install left it
+  bool upToDate(const std::string &relative, const std::string &hash);
+  bool injectFile(const std::filesystem::path &relativePath);
+  void reportProgress(uintmax_t bytes);
+
+  // Winning copy of a file across the whole mod list
+  struct OverlayFile {
+    std::filesystem::path source;
+    uintmax_t size;
+    std::string mod;
+    std::string hash;
+  };
 
   std::filesystem::path gameFolder;
+  InstallMode installMode;
   std::vector<Mod> modList;
-  std::vector<Mod> compiledList;
+  ModRegistry modIndex;
+  ModRegistry compiledList;
+  // Outcome of every dependency and incompatibility entry checked during
+  // this compile: the mod that met or clashed with it, empty if none
+  std::unordered_map<std::string, std::string> dependencyMemo;
+  std::unordered_map<std::string, std::string> incompatibleMemo;
+
+  std::map<std::string, OverlayFile> overlay;
+  std::set<std::string> overlayFolders;
+  std::map<std::pair<std::string, std::string>, size_t> conflicts;
+
+  ObjectStore store;
+  Manifest manifest;
+  std::mutex manifestMutex;
+  ThreadPool pool;
+
+  std::function<void(size_t, size_t, uintmax_t)> progress;
+  std::atomic<bool> cancelled;
+  std::atomic<size_t> unchangedFiles;
+  std::mutex progressMutex;
+  size_t filesDone;
+  size_t filesTotal;
+  uintmax_t bytesDone;
 
-  Logger *log;
+  Log *log;
 };
 
 } // namespace BML
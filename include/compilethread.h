@@ -0,0 +1,31 @@
+#ifndef COMPILETHREAD_H
+#define COMPILETHREAD_H
+
+#include "compiler.h"
+#include <QElapsedTimer>
+#include <QThread>
+
+namespace BML {
+
+// Runs Compiler::compile() off the GUI thread and reports its progress
+class CompileThread : public QThread {
+  Q_OBJECT
+
+public:
+  explicit CompileThread(Compiler *compiler, QObject *parent = nullptr);
+
+signals:
+  void progress(qulonglong done, qulonglong total, qulonglong bytes);
+  void compiled(int result);
+
+protected:
+  void run() override;
+
+private:
+  Compiler *compiler;
+  QElapsedTimer throttle;
+};
+
+} // namespace BML
+
+#endif // COMPILETHREAD_H
@@ -0,0 +1,34 @@
+#ifndef FILEOPS_H
+#define FILEOPS_H
+
+#include <filesystem>
+
+namespace BML {
+
+enum class CopyMethod { Reflink, Hardlink, Copy };
+
+// True if both paths (or their nearest existing parents) live on the same
+// filesystem, so links and renames between them are possible
+bool sameFilesystem(const std::filesystem::path &a,
+                    const std::filesystem::path &b);
+
+// Share the data blocks of source with a new file at dest (FICLONE on btrfs
+// and XFS), the result is copy-on-write so either file can change safely
+bool reflinkFile(const std::filesystem::path &source,
+                 const std::filesystem::path &dest);
+
+// Make dest a copy of source the cheapest way the filesystem allows: reflink,
+// then hardlink (if allowed, both names then share one file), then a byte
+// copy. Replaces dest if it exists.
+CopyMethod cloneFile(const std::filesystem::path &source,
+                     const std::filesystem::path &dest, bool allowHardlink);
+
+// Rename source to dest. Across filesystems, where a rename is impossible,
+// copy to a temporary file next to dest, rename that into place and remove
+// source. Returns false if the data had to be copied.
+bool moveFile(const std::filesystem::path &source,
+              const std::filesystem::path &dest);
+
+} // namespace BML
+
+#endif // FILEOPS_H
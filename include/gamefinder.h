@@ -0,0 +1,45 @@
+#ifndef GAMEFINDER_H
+#define GAMEFINDER_H
+
+#include <QString>
+#include <QThread>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+namespace BML {
+
+std::filesystem::path getUserHomeDirectory();
+
+// Usual Steam, GOG and Wine install locations, most likely first
+std::vector<std::filesystem::path>
+knownGameFolders(const std::filesystem::path &homeDir);
+
+// Breadth-first search below startDir for a folder named Borderlands. Hidden
+// and cache folders are skipped, and the search gives up past maxDepth, at
+// the deadline or once stop returns true.
+bool findBorderlandsGameFolder(
+    const std::filesystem::path &startDir, std::filesystem::path &foundPath,
+    size_t maxDepth, std::chrono::steady_clock::time_point deadline,
+    const std::function<bool()> &stop);
+
+// Looks for the game folder off the GUI thread: known locations first, then a
+// bounded search of the home directory
+class GameFinderThread : public QThread {
+  Q_OBJECT
+
+public:
+  explicit GameFinderThread(QObject *parent = nullptr);
+
+signals:
+  void found(QString path);
+  void notFound();
+
+protected:
+  void run() override;
+};
+
+} // namespace BML
+
+#endif // GAMEFINDER_H
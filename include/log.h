@@ -0,0 +1,145 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace BML {
+
+enum class LogLevel { Debug, Info, Warning, Error };
+
+const char *logLevelName(LogLevel level);
+
+struct LogRecord {
+  uint64_t sequence;
+  LogLevel level;
+  // Milliseconds since the log was created
+  int64_t elapsed;
+  std::string subsystem;
+  std::string mod;
+  std::string path;
+  std::string message;
+};
+
+// Receives records in the order they were written. Sinks are only ever called
+// from one thread at a time.
+class LogSink {
+
+public:
+  virtual ~LogSink() {}
+  virtual void write(const std::vector<LogRecord> &records) = 0;
+};
+
+// Message text only, for a terminal
+class StreamSink : public LogSink {
+
+public:
+  StreamSink(std::ostream &stream, LogLevel minLevel = LogLevel::Debug);
+
+  void write(const std::vector<LogRecord> &records) override;
+
+private:
+  std::ostream &stream;
+  LogLevel minLevel;
+};
+
+// Plain text file that is moved to file.1, file.2, ... once it grows past
+// maxBytes, keeping at most maxFiles files. The previous session is rotated
+// out on creation.
+class RotatingFileSink : public LogSink {
+
+public:
+  RotatingFileSink(std::filesystem::path file, uintmax_t maxBytes,
+                   size_t maxFiles);
+  ~RotatingFileSink();
+
+  void write(const std::vector<LogRecord> &records) override;
+
+  // Files written during this session, oldest first
+  std::vector<std::filesystem::path> sessionFiles();
+
+protected:
+  virtual std::string format(const LogRecord &record);
+
+private:
+  void rotate();
+
+  std::filesystem::path file;
+  uintmax_t maxBytes;
+  size_t maxFiles;
+  uintmax_t written;
+  size_t rotations;
+  std::ofstream out;
+};
+
+// One JSON object per line, for tooling
+class JsonLinesSink : public RotatingFileSink {
+
+public:
+  using RotatingFileSink::RotatingFileSink;
+
+protected:
+  std::string format(const LogRecord &record) override;
+};
+
+// Thread-safe structured log. Writers push onto a lock-free list and never
+// wait on a sink, a background thread hands the records to the sinks in
+// batches. The thread sleeps while there is nothing to write, and whatever is
+// written while it writes a batch makes up the next one.
+class Log {
+
+public:
+  Log();
+  ~Log();
+
+  // Sinks are not owned and must be removed or outlive the log
+  void addSink(LogSink *sink);
+  void removeSink(LogSink *sink);
+
+  void write(LogLevel level, const std::string &subsystem,
+             const std::string &message, const std::string &mod = "",
+             const std::string &path = "");
+  void debug(const std::string &subsystem, const std::string &message,
+             const std::string &mod = "", const std::string &path = "");
+  void info(const std::string &subsystem, const std::string &message,
+            const std::string &mod = "", const std::string &path = "");
+  void warning(const std::string &subsystem, const std::string &message,
+               const std::string &mod = "", const std::string &path = "");
+  void error(const std::string &subsystem, const std::string &message,
+             const std::string &mod = "", const std::string &path = "");
+
+  // Hands everything written so far to the sinks before returning
+  void flush();
+  void stop();
+
+private:
+  struct Node {
+    LogRecord record;
+    Node *next;
+  };
+
+  std::chrono::steady_clock::time_point start;
+  std::atomic<uint64_t> sequence;
+  std::atomic<Node *> head;
+
+  std::vector<LogSink *> sinks;
+  std::mutex sinkMutex;
+
+  std::thread worker;
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  bool stopping;
+};
+
+} // namespace BML
+
+#endif // LOG_H
@@ -1,24 +1,52 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
-#include <QTextEdit>
+#include "log.h"
+#include <QPlainTextEdit>
+#include <QStringList>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
+#include <mutex>
 
 namespace BML {
 
-class Logger : public QWidget {
+// Log widget and owner of the session's structured log. Records from any
+// thread are shown in batches so a busy install never waits on text layout.
+// The widget only keeps the most recent lines, the full history is written to
+// bml.log and bml.jsonl.
+class Logger : public QWidget, public LogSink {
   Q_OBJECT
 
 public:
   explicit Logger(QWidget *parent = nullptr);
+  ~Logger();
+
+  Log *backend();
+  void write(const std::vector<LogRecord> &records) override;
 
 public slots:
   void appendLogMessage(const QString &message);
-  QString exportLog();
+  bool exportLog(const QString &fileName);
+  void flush();
 
 private:
-  QTextEdit *textEdit;
+  // Roughly 30 updates per second
+  static const int flushInterval = 33;
+  static const int maxLines = 5000;
+  static const uintmax_t maxFileSize = 8 * 1024 * 1024;
+  static const size_t maxFiles = 5;
+
+  QPlainTextEdit *textEdit;
+  QTimer *flushTimer;
+
+  QStringList pending;
+  std::mutex pendingMutex;
+
+  RotatingFileSink fileSink;
+  JsonLinesSink jsonSink;
+  // Declared last so it stops before the sinks go away
+  Log log;
 };
 
 } // namespace BML
@@ -0,0 +1,40 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+
+namespace BML {
+
+// Record of every file the last install wrote into the game folder, used to
+// turn the next install into a delta against it.
+class Manifest {
+
+public:
+  struct Entry {
+    uintmax_t size;
+    int64_t mtime;
+    std::string hash;
+    std::string mod;
+    bool original;
+  };
+
+  Manifest(std::filesystem::path file);
+  ~Manifest();
+
+  bool load();
+  bool save();
+  void clear();
+
+  std::string gameFolder;
+  std::map<std::string, Entry> files;
+
+private:
+  std::filesystem::path file;
+};
+
+} // namespace BML
+
+#endif // MANIFEST_H
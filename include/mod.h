@@ -1,6 +1,7 @@
 #ifndef MOD_H
 #define MOD_H
 
+#include "version.h"
 #include <QString>
 #include <cstdint>
 #include <string>
@@ -12,30 +13,38 @@ class Mod {
 
 public:
   Mod();
-  Mod(std::string name);
-  Mod(std::string name, std::string author);
-  Mod(std::string name, std::string author, std::string version);
+  Mod(const std::string &name);
+  Mod(const std::string &name, const std::string &author);
+  Mod(const std::string &name, const std::string &author,
+      const std::string &version);
   ~Mod();
 
-  std::string name();
-  std::string author();
-  std::string version();
-  std::string majorVersion();
-  std::string minorVersion();
-  std::string path();
-  std::string print();
-  QString printQString();
+  const std::string &name() const;
+  const std::string &author() const;
+  const std::string &version() const;
+  const std::string &majorVersion() const;
+  const std::string &minorVersion() const;
+  const std::string &path() const;
+  // Version parsed once, and the same text read as a constraint for
+  // dependencies and incompatibilities
+  const Version &versionNumber() const;
+  const VersionConstraint &versionConstraint() const;
+  std::string print() const;
+  QString printQString() const;
 
   std::vector<Mod> dependencies;
   std::vector<Mod> incompatibilities;
 
-  void setName(std::string name);
-  void setAuthor(std::string author);
-  void setVersion(std::string version);
-  void setPath(std::string path);
+  void setName(const std::string &name);
+  void setAuthor(const std::string &author);
+  void setVersion(const std::string &version);
+  void setPath(const std::string &path);
 
-  uint8_t checkValid();
-  bool compare(Mod mod);
+  uint8_t checkValid() const;
+  // For dependency and incompatibility entries, which have no path and whose
+  // version is a constraint
+  uint8_t checkConstraint() const;
+  bool compare(const Mod &mod) const;
 
 private:
   std::string m_name;
@@ -43,6 +52,8 @@ private:
   std::string m_version;
   std::string m_majorVersion;
   std::string m_minorVersion;
+  Version m_versionNumber;
+  VersionConstraint m_versionConstraint;
 
   std::string m_path;
 };
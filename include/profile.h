@@ -0,0 +1,44 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "mod.h"
+#include "scancache.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace BML {
+
+// Named active mod list. Only the identity and folder of each mod are saved,
+// in load order, together with a hash of that list so a profile edited by hand
+// can be told apart from the one that was saved.
+class Profile {
+
+public:
+  Profile();
+  Profile(std::string name, std::vector<Mod> mods);
+  ~Profile();
+
+  // ./Profiles
+  static std::filesystem::path folder();
+  static std::filesystem::path file(const std::string &name);
+
+  bool load(const std::filesystem::path &file);
+  bool save(const std::filesystem::path &file);
+
+  std::string hash();
+
+  // Full mods for every identity, read through the scan cache so an unchanged
+  // mod folder is not parsed again. Identities that cannot be found are
+  // returned in missing.
+  std::vector<Mod> resolve(ScanCache *cache, std::vector<Mod> &missing);
+
+  std::string name;
+  std::vector<Mod> mods;
+  // Hash stored in the file, empty when the profile was never saved
+  std::string savedHash;
+};
+
+} // namespace BML
+
+#endif // PROFILE_H
@@ -0,0 +1,50 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "mod.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace BML {
+
+// Mods indexed by name and author, with every version of a mod in its own
+// bucket, and by folder. Keeps the order mods were added in.
+class ModRegistry {
+
+public:
+  ModRegistry();
+  ~ModRegistry();
+
+  // False if the same name, author and version is already registered
+  bool add(const Mod &mod);
+  void clear();
+  size_t size() const;
+
+  const std::vector<Mod> &mods() const;
+
+  // Exact name, author and version
+  const Mod *find(const Mod &identity) const;
+  const Mod *findPath(const std::string &path) const;
+  // Every registered version of the mod with identity's name and author,
+  // oldest first by version number
+  std::vector<const Mod *> versions(const Mod &identity) const;
+
+private:
+  static std::string key(const Mod &mod);
+  // Version number first so buckets iterate in version order, with the text
+  // kept since mods are identified by the version they were written with
+  using VersionKey = std::pair<uint64_t, std::string>;
+  static VersionKey versionKey(const Mod &mod);
+
+  std::vector<Mod> list;
+  // Positions in list, so adding never invalidates the index
+  std::unordered_map<std::string, std::map<VersionKey, size_t>> index;
+  std::unordered_map<std::string, size_t> paths;
+};
+
+} // namespace BML
+
+#endif // REGISTRY_H
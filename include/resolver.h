@@ -0,0 +1,41 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "mod.h"
+#include "registry.h"
+#include <chrono>
+#include <vector>
+
+namespace BML {
+
+// Order mods so every mod comes after the mods in the list that satisfy its
+// dependencies, otherwise keeping the order they were given in. Dependencies
+// not satisfied by the list are left to dependCheck. A mod listed again with
+// the same version is left out of sorted and added to duplicates. Returns
+// false and the mods forming the loop when the dependencies are circular.
+bool sortLoadOrder(const std::vector<Mod> &mods, std::vector<Mod> &sorted,
+                   std::vector<Mod> &duplicates, std::vector<Mod> &cycle);
+
+struct Resolution {
+  bool solved = false;
+  // Ran out of time, the conflict may not be minimal
+  bool timedOut = false;
+  // The requested mods followed by the dependencies picked for them
+  std::vector<Mod> mods;
+  // Requests that cannot be installed together, none of which can be left out
+  // without the rest becoming installable
+  std::vector<Mod> conflict;
+};
+
+// Pick one version of every requested mod and of everything they depend on
+// from the available mods, so that every dependency is met and no two picked
+// mods are incompatible. Requests are read like dependency entries, so a
+// request for an exact version pins it. Newer versions are tried first.
+Resolution
+resolveVersions(const std::vector<Mod> &requests, const ModRegistry &available,
+                std::chrono::milliseconds budget = std::chrono::milliseconds(
+                    100));
+
+} // namespace BML
+
+#endif // RESOLVER_H
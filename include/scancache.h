@@ -0,0 +1,46 @@
+#ifndef SCANCACHE_H
+#define SCANCACHE_H
+
+#include "mod.h"
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace BML {
+
+// Parsed bml.json files from previous scans, keyed by mod folder and checked
+// against the size and modification time of the bml.json they came from.
+// Safe to use from several threads at once.
+class ScanCache {
+
+public:
+  ScanCache(std::filesystem::path file);
+  ~ScanCache();
+
+  bool load();
+  bool save();
+
+  bool find(const std::filesystem::path &folder, Mod &mod);
+  void insert(const std::filesystem::path &folder, const Mod &mod);
+
+private:
+  struct Entry {
+    uintmax_t size;
+    int64_t mtime;
+    Mod mod;
+    bool used;
+  };
+
+  bool stat(const std::filesystem::path &folder, uintmax_t &size,
+            int64_t &mtime);
+
+  std::filesystem::path file;
+  std::unordered_map<std::string, Entry> entries;
+  std::mutex mutex;
+};
+
+} // namespace BML
+
+#endif // SCANCACHE_H
@@ -0,0 +1,33 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include "mod.h"
+#include "scancache.h"
+#include <QString>
+#include <filesystem>
+#include <vector>
+
+namespace BML {
+
+// Outcome of reading one mod folder. The log lines are kept with the result
+// so folders scanned in parallel can still be reported in a fixed order.
+struct ScanResult {
+  bool found = false;
+  bool valid = false;
+  Mod mod;
+  std::vector<QString> messages;
+};
+
+// Read the bml.json of a single mod folder, from the cache if it is unchanged.
+// Safe to call from several threads at once.
+ScanResult scanModFolder(const std::filesystem::path &folder,
+                         ScanCache *cache);
+
+// Read every mod folder directly inside modsFolder on a thread pool. Results
+// are returned sorted by folder path.
+std::vector<ScanResult> scanModsFolder(const std::filesystem::path &modsFolder,
+                                       ScanCache *cache);
+
+} // namespace BML
+
+#endif // SCANNER_H
@@ -0,0 +1,55 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace BML {
+
+// Persistent content-addressed store of mod files. Objects are keyed by the
+// SHA-1 of their content and only made where the filesystem can reflink, a
+// byte copy would cost as much as staging from the mod itself. Staging
+// reflinks or copies and never hardlinks: the staged file ends up in the game
+// folder, where a patch may rewrite it in place. Safe to use from several
+// threads at once.
+class ObjectStore {
+
+public:
+  ObjectStore(std::filesystem::path root);
+  ~ObjectStore();
+
+  bool load();
+  bool save();
+
+  std::string hashFile(const std::filesystem::path &file);
+  // Hash of file, adding it to the store if it can be reflinked
+  std::string store(const std::filesystem::path &file);
+  // Hash of file, after making one copy of it at dest
+  std::string stage(const std::filesystem::path &file,
+                    const std::filesystem::path &dest);
+
+  std::filesystem::path objectPath(const std::string &hash);
+
+  // Remove every object, and every index entry, whose hash is not in keep.
+  // Returns the number of objects removed.
+  size_t prune(const std::set<std::string> &keep);
+
+private:
+  struct IndexEntry {
+    uintmax_t size;
+    int64_t mtime;
+    std::string hash;
+  };
+
+  std::filesystem::path root;
+  std::unordered_map<std::string, IndexEntry> index;
+  std::mutex mutex;
+};
+
+} // namespace BML
+
+#endif // STORE_H
@@ -0,0 +1,42 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BML {
+
+// Fixed set of worker threads fed from a bounded queue. submit() blocks while
+// the queue is full so walking a huge tree never queues more than a few
+// batches of work ahead of the workers.
+class ThreadPool {
+
+public:
+  ThreadPool(size_t threads = 0);
+  ~ThreadPool();
+
+  void submit(std::function<void()> task);
+  void wait();
+  size_t size() const;
+
+private:
+  void work();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable taskQueued;
+  std::condition_variable taskTaken;
+  std::condition_variable tasksDone;
+  size_t maxQueued;
+  size_t running;
+  bool stopping;
+};
+
+} // namespace BML
+
+#endif // THREADPOOL_H
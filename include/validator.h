@@ -0,0 +1,45 @@
+#ifndef VALIDATOR_H
+#define VALIDATOR_H
+
+#include "mod.h"
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace BML {
+
+// Missing dependencies and incompatibilities of the active mod list, kept up
+// to date as mods are added and removed. A change only rechecks the mods with
+// an entry naming the mod that changed. Order does not matter since compile
+// moves dependencies ahead of the mods that need them. Mods are identified by
+// path.
+class ListValidator {
+
+public:
+  ListValidator();
+  ~ListValidator();
+
+  // Paths of the mods whose problems may have changed
+  std::vector<std::string> add(const Mod &mod);
+  std::vector<std::string> remove(const std::string &path);
+  void clear();
+
+  // Problems of a mod in the list, empty if there are none
+  const std::vector<std::string> &problems(const std::string &path);
+
+private:
+  static std::string key(const Mod &mod);
+  void check(const std::string &path);
+
+  std::unordered_map<std::string, Mod> mods;
+  // Paths of the listed mods by name and author
+  std::unordered_map<std::string, std::set<std::string>> listed;
+  // Paths of the listed mods with an entry naming a name and author
+  std::unordered_map<std::string, std::set<std::string>> watchers;
+  std::unordered_map<std::string, std::vector<std::string>> found;
+};
+
+} // namespace BML
+
+#endif // VALIDATOR_H
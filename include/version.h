@@ -0,0 +1,53 @@
+#ifndef VERSION_H
+#define VERSION_H
+
+#include <cstdint>
+#include <string>
+
+namespace BML {
+
+// MAJOR.MINOR version of a mod, as one integer so versions compare with a
+// single integer comparison
+struct Version {
+  bool valid = false;
+  uint32_t major = 0;
+  uint32_t minor = 0;
+
+  uint64_t key() const { return (uint64_t(major) << 32) | minor; }
+
+  static Version parse(const std::string &text);
+};
+
+// Version requirement of a dependency or incompatibility, compiled once into
+// an integer range and an optional fixed minor version. Accepts one or more
+// comparisons that must all hold, separated by spaces or commas:
+//   1.2          exactly 1.2
+//   1.X or 1     any 1.x
+//   X.2          any major version with minor version 2
+//   X.X, X or *  any version
+//   >=1.2 <2.0   comparisons with >=, >, <=, < and =
+class VersionConstraint {
+
+public:
+  VersionConstraint();
+
+  static VersionConstraint parse(const std::string &text);
+
+  bool valid() const { return m_valid; }
+  bool matches(const Version &version) const {
+    uint64_t key = version.key();
+    return version.valid & (key >= lowest) & (key <= highest) &
+           (!fixedMinor | (version.minor == minor));
+  }
+
+private:
+  bool m_valid;
+  uint64_t lowest;
+  uint64_t highest;
+  bool fixedMinor;
+  uint32_t minor;
+};
+
+} // namespace BML
+
+#endif // VERSION_H
@@ -2,14 +2,26 @@
 #define WINDOW_H
 
 #include "compiler.h"
+#include "compilethread.h"
+#include "gamefinder.h"
 #include "logger.h"
 #include "mod.h"
+#include "profile.h"
+#include "registry.h"
+#include "resolver.h"
+#include "scancache.h"
+#include "scanner.h"
+#include "validator.h"
+#include <QCheckBox>
 #include <QLabel>
 #include <QLineEdit>
 #include <QListWidget>
 #include <QMainWindow>
+#include <QProgressBar>
 #include <QPushButton>
+#include <QSettings>
 #include <qmarkdowntextedit.h>
+#include <unordered_map>
 #include <vector>
 
 namespace BML {
@@ -18,9 +30,15 @@ class Window : public QMainWindow {
   Q_OBJECT
 public:
   explicit Window(QWidget *parent = nullptr);
+
+protected:
+  void closeEvent(QCloseEvent *event) override;
+
 private slots:
   void handleModsFolderButton();
   void handleGameFolderButton();
+  void handleGameFolderFound(QString path);
+  void handleGameFolderNotFound();
 
   void handleAddModButton();
   void handleRemoveModButton();
@@ -32,13 +50,28 @@ private slots:
 
   void handleSearchForModsButton();
   void handleApplyModsButton();
+  void handleSaveProfileButton();
+  void handleLoadProfileButton();
   void handleCompileModsButton();
+  void handleCancelCompileButton();
+  void handleCompileProgress(qulonglong done, qulonglong total,
+                             qulonglong bytes);
+  void handleCompileFinished(int result);
 
   void handleExportLogButton();
 
-  bool loadMod(Mod mod);
+  bool loadMod(const Mod &mod);
 
 private:
+  void saveFolders();
+  std::vector<Mod> appliedMods();
+  // Rows of the active mods list are only added and removed through these,
+  // which keep the live checks of the list current
+  void addAppliedMod(const Mod &mod);
+  void removeAppliedMod(QListWidgetItem *item);
+  void clearAppliedMods();
+  void showProblems(const std::vector<std::string> &paths);
+
   QPushButton *modsPathButton;
   QLineEdit *modsPathLine;
   QLabel *modsPathLabel;
@@ -63,7 +96,12 @@ private:
 
   QPushButton *searchForModsButton;
   QPushButton *applyModsButton;
+  QPushButton *saveProfileButton;
+  QPushButton *loadProfileButton;
   QPushButton *compileModsButton;
+  QPushButton *cancelCompileButton;
+  QProgressBar *compileProgress;
+  QCheckBox *directInstallBox;
 
   QPushButton *exportLogButton;
 
@@ -71,12 +109,21 @@ private:
   QLabel *logLabel;
 
   Compiler *compiler;
+  CompileThread *compileThread;
+  GameFinderThread *gameFinder;
+
+  ScanCache *scanCache;
+  QSettings *settings;
 
   QLabel *bmlLabel;
 
-  std::vector<Mod> loadedMods;
+  ModRegistry loadedMods;
+  ListValidator appliedCheck;
+  // Rows of the active mods list by mod path
+  std::unordered_map<std::string, QListWidgetItem *> appliedItems;
 
   const char *versionNum = "0.1";
+  const char *gamePathPlaceholder = "Insert Game Folder Location Here";
 };
 
 } // namespace BML
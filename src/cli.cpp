@@ -0,0 +1,253 @@
+#include "cli.h"
+#include "compiler.h"
+#include "gamefinder.h"
+#include "log.h"
+#include "profile.h"
+#include "registry.h"
+#include "resolver.h"
+#include "scancache.h"
+#include "scanner.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QSettings>
+#include <iostream>
+
+namespace BML {
+
+// Valid mods of the mods folder, in folder order with duplicates dropped
+static ModRegistry scanMods(const std::filesystem::path &modsFolder,
+                            Log &log) {
+  ModRegistry mods;
+  ScanCache cache(std::filesystem::current_path() / "Cache" / "scan.json");
+  cache.load();
+
+  log.info("scan", "\nSearching for mods at " + modsFolder.string());
+  for (auto &result : scanModsFolder(modsFolder, &cache)) {
+    if (!result.found) {
+      continue;
+    }
+    for (auto &message : result.messages) {
+      log.info("scan", message.toStdString(), "", result.mod.path());
+    }
+    if (!result.valid || result.mod.checkValid() != 0) {
+      continue;
+    }
+
+    if (!mods.add(result.mod)) {
+      log.warning("scan", "-- !! Duplicate mod detected !! Ignoring mod in "
+                          "folder \"" +
+                              result.mod.path() + "\" !!");
+    }
+  }
+
+  try {
+    cache.save();
+  } catch (const std::filesystem::filesystem_error &e) {
+    log.warning("scan",
+                "- Failed to save scan cache : " + std::string(e.what()));
+  }
+  return mods;
+}
+
+bool isCliCommand(int argc, char *argv[]) {
+  if (argc < 2) {
+    return false;
+  }
+
+  std::string first = argv[1];
+  if (first == "install" || first == "restore" || first == "scan" ||
+      first == "-h" || first == "-?") {
+    return true;
+  }
+  if (first.rfind("--", 0) != 0) {
+    return false;
+  }
+
+  // Options may carry their value after an equals sign
+  std::string name = first.substr(2, first.find('=') - 2);
+  for (const char *option : {"help", "help-all", "mods", "game", "profile",
+                             "direct", "resolve", "quiet"}) {
+    if (name == option) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int runCli(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("bml");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Borderlands Mod Loader");
+  parser.addHelpOption();
+  QCommandLineOption modsOption("mods", "Folder containing the mods.", "dir");
+  QCommandLineOption gameOption("game", "Game folder to install into.", "dir");
+  QCommandLineOption profileOption(
+      "profile", "JSON list of mods to install, in load order.", "file");
+  QCommandLineOption directOption(
+      "direct", "Install straight into the game folder without staging.");
+  QCommandLineOption resolveOption(
+      "resolve", "Also install what the profile's mods depend on, picked from "
+                 "the mods folder.");
+  QCommandLineOption quietOption("quiet", "Only print warnings and errors.");
+  parser.addOptions({modsOption, gameOption, profileOption, directOption,
+                     resolveOption, quietOption});
+  parser.addPositionalArgument("command", "install, restore or scan.");
+  parser.process(app);
+
+  StreamSink sink(std::cout, parser.isSet(quietOption) ? LogLevel::Warning
+                                                       : LogLevel::Debug);
+  Log log;
+  log.addSink(&sink);
+
+  QStringList arguments = parser.positionalArguments();
+  std::string command =
+      arguments.size() == 1 ? arguments.at(0).toStdString() : "";
+  if (command != "install" && command != "restore" && command != "scan") {
+    log.error("cli", parser.helpText().toStdString());
+    return 11;
+  }
+
+  // Fall back to the folders the window last used
+  QSettings settings(
+      QString((std::filesystem::current_path() / "bml.ini").c_str()),
+      QSettings::IniFormat);
+  std::filesystem::path modsFolder = std::filesystem::current_path() / "Mods";
+  if (parser.isSet(modsOption)) {
+    modsFolder = parser.value(modsOption).toStdString();
+  } else if (settings.contains("modsFolder")) {
+    modsFolder = settings.value("modsFolder").toString().toStdString();
+  }
+  std::filesystem::path gameFolder;
+  if (parser.isSet(gameOption)) {
+    gameFolder = parser.value(gameOption).toStdString();
+  } else if (settings.contains("gameFolder")) {
+    gameFolder = settings.value("gameFolder").toString().toStdString();
+  }
+  if (gameFolder.empty()) {
+    for (auto &folder : knownGameFolders(getUserHomeDirectory())) {
+      if (std::filesystem::is_directory(folder)) {
+        gameFolder = folder;
+        break;
+      }
+    }
+  }
+
+  if (command == "scan") {
+    if (!std::filesystem::is_directory(modsFolder)) {
+      log.error("cli", "!! ERROR !! Mods folder " + modsFolder.string() +
+                           " does not exist");
+      return 11;
+    }
+    ModRegistry mods = scanMods(modsFolder, log);
+
+    // The list is the actual output, so it is printed even when quiet
+    log.flush();
+    for (auto &mod : mods.mods()) {
+      std::cout << mod.print() << " : " << mod.path() << "\n";
+    }
+    return 0;
+  }
+
+  if (gameFolder.empty() || !std::filesystem::is_directory(gameFolder)) {
+    log.error("cli", "!! ERROR !! No game folder, pass one with --game");
+    return 11;
+  }
+
+  Compiler compiler(&log);
+  compiler.setPath(gameFolder.string());
+  compiler.setInstallMode(parser.isSet(directOption) ? InstallMode::Direct
+                                                     : InstallMode::Staged);
+
+  if (command == "restore") {
+    return compiler.restore();
+  }
+
+  if (!parser.isSet(profileOption)) {
+    log.error("cli", "!! ERROR !! install needs a profile, pass one with "
+                     "--profile");
+    return 11;
+  }
+
+  // Either a profile file or the name of one saved by the window
+  std::filesystem::path profileFile = parser.value(profileOption).toStdString();
+  if (!std::filesystem::exists(profileFile)) {
+    profileFile = Profile::file(profileFile.string());
+  }
+  Profile profile;
+  if (!profile.load(profileFile)) {
+    log.error("profile",
+              "!! ERROR !! Failed to read profile " + profileFile.string(), "",
+              profileFile.string());
+    return 12;
+  }
+
+  // Mods the profile knows the folder of are read through the scan cache,
+  // the others are looked up in the mods folder
+  ScanCache cache(std::filesystem::current_path() / "Cache" / "scan.json");
+  cache.load();
+  std::vector<Mod> unresolved;
+  std::vector<Mod> resolved = profile.resolve(&cache, unresolved);
+  try {
+    cache.save();
+  } catch (const std::filesystem::filesystem_error &e) {
+    log.warning("scan",
+                "- Failed to save scan cache : " + std::string(e.what()));
+  }
+
+  ModRegistry available;
+  if (!unresolved.empty() || parser.isSet(resolveOption)) {
+    available = scanMods(modsFolder, log);
+  }
+
+  std::vector<Mod> mods;
+  size_t next = 0;
+  for (auto &identity : profile.mods) {
+    if (next < resolved.size() && resolved[next].compare(identity) == 0) {
+      mods.push_back(resolved[next++]);
+      continue;
+    }
+
+    const Mod *mod = available.find(identity);
+    if (!mod) {
+      log.error("cli", "!! ERROR !! Mod " + identity.print() +
+                           " from the profile is not in " +
+                           modsFolder.string(),
+                identity.print());
+      return 12;
+    }
+    mods.push_back(*mod);
+  }
+
+  if (parser.isSet(resolveOption)) {
+    // Mods from outside the mods folder can still be depended on
+    for (auto &mod : mods) {
+      available.add(mod);
+    }
+    Resolution resolution = resolveVersions(mods, available);
+    if (resolution.timedOut) {
+      log.error("depend", "!! ERROR !! Could not work out the dependencies "
+                          "in time");
+      return 13;
+    }
+    if (!resolution.solved) {
+      log.error("depend", "!! ERROR !! These mods cannot be installed "
+                          "together:");
+      for (auto &mod : resolution.conflict) {
+        log.error("depend", "  - " + mod.print(), mod.print());
+      }
+      return 13;
+    }
+    for (size_t i = mods.size(); i < resolution.mods.size(); i++) {
+      log.info("depend", "-- Adding dependency " + resolution.mods[i].print(),
+               resolution.mods[i].print());
+    }
+    mods = resolution.mods;
+  }
+
+  compiler.setModList(mods);
+  return compiler.compile();
+}
+
+} // namespace BML
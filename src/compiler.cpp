@@ -1,28 +1,129 @@
 #include "compiler.h"
+#include "fileops.h"
+#include "resolver.h"
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
 
 namespace BML {
 
-Compiler::Compiler(Logger *log) : log(log) {}
+static std::string quoted(const std::string &text) {
+  return "\"" + text + "\"";
+}
+
+// Dependency and incompatibility entries asking for the same thing share a key
+static std::string entryKey(const Mod &entry) {
+  return entry.name() + '\n' + entry.author() + '\n' + entry.version();
+}
+
+// Folders are the same however they were written, relative or with a
+// trailing separator
+static bool sameFolder(const std::filesystem::path &a,
+                       const std::filesystem::path &b) {
+  return (std::filesystem::weakly_canonical(a) / "").lexically_normal() ==
+         (std::filesystem::weakly_canonical(b) / "").lexically_normal();
+}
 
-Compiler::Compiler(std::string path, Logger *log) : log(log) {
+Compiler::Compiler(Log *log)
+    : installMode(InstallMode::Staged),
+      store(std::filesystem::current_path() / "Cache"),
+      manifest(std::filesystem::current_path() / "Manifest.json"),
+      cancelled(false), unchangedFiles(0), filesDone(0), filesTotal(0),
+      bytesDone(0), log(log) {}
+
+Compiler::Compiler(std::string path, Log *log)
+    : installMode(InstallMode::Staged),
+      store(std::filesystem::current_path() / "Cache"),
+      manifest(std::filesystem::current_path() / "Manifest.json"),
+      cancelled(false), unchangedFiles(0), filesDone(0), filesTotal(0),
+      bytesDone(0), log(log) {
   std::filesystem::path gameFolder = path;
 }
 
-Compiler::Compiler(std::vector<Mod> list, std::string path, Logger *log)
-    : modList(list), log(log) {
+Compiler::Compiler(std::vector<Mod> list, std::string path, Log *log)
+    : installMode(InstallMode::Staged), modList(list),
+      store(std::filesystem::current_path() / "Cache"),
+      manifest(std::filesystem::current_path() / "Manifest.json"),
+      cancelled(false), unchangedFiles(0), filesDone(0), filesTotal(0),
+      bytesDone(0), log(log) {
   std::filesystem::path gameFolder = path;
+  for (auto &mod : modList) {
+    modIndex.add(mod);
+  }
 }
 
 Compiler::~Compiler() {}
 
 uint8_t Compiler::compile() {
-  log->appendLogMessage("\n****************************\n");
-  log->appendLogMessage("Beginning compile!");
+  log->info("compile", "\n****************************\n");
+  log->info("compile", "Beginning compile!");
 
   compiledList.clear();
+  dependencyMemo.clear();
+  incompatibleMemo.clear();
+  overlay.clear();
+  overlayFolders.clear();
+  conflicts.clear();
+  cancelled = false;
+  filesDone = 0;
+  filesTotal = 0;
+  bytesDone = 0;
+
+  // Checked before anything is deleted, a circular dependency cannot be
+  // installed in any order
+  std::vector<Mod> loadOrder;
+  std::vector<Mod> duplicates;
+  std::vector<Mod> cycle;
+  if (!sortLoadOrder(modList, loadOrder, duplicates, cycle)) {
+    log->error("compile", "\n!! ERROR !! COMPILE FAILED : Circular "
+                          "dependency between:");
+    for (auto &mod : cycle) {
+      log->error("compile", "  - " + quoted(mod.print()), mod.print());
+    }
+    return 5;
+  }
+
+  for (auto &mod : duplicates) {
+    log->warning("compile", "-- !! Duplicate mod detected !! Ignoring " +
+                 quoted(mod.print()) + " listed more than once !!",
+                 mod.print());
+  }
+
+  // The mod index holds the list without its duplicates, in the same order
+  const std::vector<Mod> &listed = modIndex.mods();
+  bool reordered = loadOrder.size() != listed.size();
+  for (size_t i = 0; !reordered && i < loadOrder.size(); i++) {
+    reordered = loadOrder[i].compare(listed[i]) != 0;
+  }
+  if (reordered) {
+    log->info("compile", "- Moved dependencies ahead of the mods that need "
+                         "them, installing in this order:");
+    for (auto &mod : loadOrder) {
+      log->info("compile", "  - " + quoted(mod.print()), mod.print());
+    }
+  }
+
+  // The whole list is checked before the staging folder is touched, so a
+  // missing dependency costs no staging work
+  for (auto &mod : loadOrder) {
+    log->info("compile", "--  Checking dependencies of " + quoted(mod.print()),
+              mod.print());
+    if (!dependCheck(mod)) {
+      log->error("compile", "\n!! ERROR !! COMPILE FAILED : Dependency error!");
+      return 1;
+    }
+
+    log->info("compile", "--  Checking incompatibilities of " +
+              quoted(mod.print()), mod.print());
+    if (!incompatibleCheck(mod)) {
+      log->error("compile",
+                 "\n!! ERROR !! COMPILE FAILED : Incompatibility error!");
+      return 2;
+    }
+
+    compiledList.add(mod);
+  }
+
   std::filesystem::path stagingFolder =
       std::filesystem::current_path() / "Staging";
 
@@ -30,158 +131,198 @@ uint8_t Compiler::compile() {
     // Check if the directory exists
     if (std::filesystem::exists(stagingFolder) &&
         std::filesystem::is_directory(stagingFolder)) {
-      log->appendLogMessage("- Deleting old staging folder.");
+      log->info("compile", "- Deleting old staging folder.");
       std::filesystem::remove_all(stagingFolder);
     }
-    log->appendLogMessage("- Generating empty staging folder.");
-    if (!std::filesystem::create_directory(stagingFolder)) {
-      log->appendLogMessage("!! ERROR !! COMPILE FAILED : Failed to create "
-                            "empty staging folder");
-      return 7;
+    if (installMode == InstallMode::Staged) {
+      log->info("compile", "- Generating empty staging folder.");
+      if (!std::filesystem::create_directory(stagingFolder)) {
+        log->error("compile", "!! ERROR !! COMPILE FAILED : Failed to create "
+                              "empty staging folder");
+        return 7;
+      }
+    } else {
+      log->info("compile", "- Installing directly into the game folder.");
+    }
+
+    if (store.load()) {
+      log->info("compile", "- Loaded staging cache index.");
     }
 
   } catch (const std::filesystem::filesystem_error &e) {
-    log->appendLogMessage("\n!! ERROR !! COMPILE FAILED : " +
-                          QString(e.what()));
+    log->error("compile", "\n!! ERROR !! COMPILE FAILED : " +
+               std::string(e.what()));
     return 8;
   } catch (const std::exception &e) {
-    log->appendLogMessage("\n!! ERROR !! COMPILE FAILED : " +
-                          QString(e.what()));
+    log->error("compile", "\n!! ERROR !! COMPILE FAILED : " +
+               std::string(e.what()));
     return 9;
   }
 
-  for (auto &mod : modList) {
-    log->appendLogMessage("\n- Loading mod: " + mod.printQString());
+  for (auto &mod : loadOrder) {
+    if (cancelled) {
+      log->warning("compile", "\n!! COMPILE CANCELLED !!");
+      return 10;
+    }
 
-    log->appendLogMessage("--  Checking dependencies of " + mod.printQString());
-    if (!dependCheck(mod)) {
-      log->appendLogMessage("\n!! ERROR !! COMPILE FAILED : Dependency error!");
-      return 1;
+    log->info("compile", "\n- Loading mod: " + quoted(mod.print()),
+              mod.print());
+    if (!overlayMod(mod)) {
+      log->error("compile", "\n!! ERROR !! COMPILE FAILED : Staging error!");
+      return 3;
     }
+  }
 
-    log->appendLogMessage("--  Checking incompatibilities of " +
-                          mod.printQString());
-    if (!incompatibleCheck(mod)) {
-      log->appendLogMessage(
-          "\n!! ERROR !! COMPILE FAILED : Incompatibility error!");
-      return 2;
+  if (!conflicts.empty()) {
+    log->info("compile", "\n- Resolved file conflicts:");
+    for (auto &[mods, count] : conflicts) {
+      log->info("compile", "-- \"" + mods.second + "\" overrides " +
+                std::to_string(count) + " files of \"" + mods.first + "\"");
     }
-    if (!stageMod(mod)) {
-      log->appendLogMessage("\n!! ERROR !! COMPILE FAILED : Staging error!");
-      return 3;
+  }
+
+  filesTotal = overlay.size();
+  if (installMode == InstallMode::Staged && !stageOverlay()) {
+    if (cancelled) {
+      log->warning("compile", "\n!! COMPILE CANCELLED !!");
+      return 10;
     }
+    log->error("compile", "\n!! ERROR !! COMPILE FAILED : Staging error!");
+    return 3;
+  }
+
+  filesDone = 0;
+  bytesDone = 0;
+  bool injected = inject();
 
-    compiledList.push_back(mod);
+  try {
+    // Only what the game folder now holds is worth keeping in the cache
+    if (injected) {
+      std::set<std::string> installed;
+      for (auto &[relative, entry] : manifest.files) {
+        installed.insert(entry.hash);
+      }
+      size_t removed = store.prune(installed);
+      if (removed > 0) {
+        log->info("compile", "- Removed " + std::to_string(removed) +
+                  " unused files from the staging cache.");
+      }
+    }
+    store.save();
+  } catch (const std::filesystem::filesystem_error &e) {
+    log->warning("compile", "- Failed to save staging cache index : " +
+                                std::string(e.what()));
   }
-  if (!inject()) {
-    log->appendLogMessage("\n!! ERROR !! COMPILE FAILED : Inject error!");
+
+  if (!injected) {
+    if (cancelled) {
+      log->warning("compile", "\n!! COMPILE CANCELLED !! Files injected so far "
+                              "are recorded and will be updated by the next "
+                              "install.");
+      return 10;
+    }
+    log->error("compile", "\n!! ERROR !! COMPILE FAILED : Inject error!");
     return 4;
   }
 
-  log->appendLogMessage("\n** INSTALLATION SUCCEEDED **\nThe following " +
-                        QString(std::to_string(modList.size()).c_str()) +
-                        " mods have been installed:");
-  for (auto &mod : compiledList) {
-    log->appendLogMessage("  - " + mod.printQString());
+  log->info("compile", "\n** INSTALLATION SUCCEEDED **\nThe following " +
+            std::to_string(compiledList.mods().size()) +
+            " mods have been installed:");
+  for (auto &mod : compiledList.mods()) {
+    log->info("compile", "  - " + quoted(mod.print()), mod.print());
   }
-  log->appendLogMessage("\n****************************\n");
+  log->info("compile", "\n****************************\n");
   return 0;
 }
 
-void Compiler::setModList(std::vector<Mod> mods) {
+uint8_t Compiler::restore() {
+  log->info("restore", "\n****************************\n");
+  log->info("restore", "Beginning restore!");
+
+  // Injecting nothing removes everything the manifest knows about
+  compiledList.clear();
+  overlay.clear();
+  overlayFolders.clear();
+  conflicts.clear();
+  cancelled = false;
+  filesDone = 0;
+  filesTotal = 0;
+  bytesDone = 0;
+
+  if (!inject()) {
+    if (cancelled) {
+      log->warning("restore", "\n!! RESTORE CANCELLED !!");
+      return 10;
+    }
+    log->error("restore", "\n!! ERROR !! RESTORE FAILED : Inject error!");
+    return 4;
+  }
+
+  log->info("restore", "\n** RESTORE SUCCEEDED **");
+  log->info("restore", "\n****************************\n");
+  return 0;
+}
+
+void Compiler::setModList(const std::vector<Mod> &mods) {
   modList.clear();
   modList = mods;
-  log->appendLogMessage("\nMod list set! " +
-                        QString(std::to_string(modList.size()).c_str()) +
-                        " mods loaded!");
+  modIndex.clear();
+  for (auto &mod : modList) {
+    modIndex.add(mod);
+  }
+  log->info("compile", "\nMod list set! " + std::to_string(modList.size()) +
+            " mods loaded!");
   for (auto &mod : modList) {
-    log->appendLogMessage("  - " + mod.printQString());
+    log->info("compile", "  - " + quoted(mod.print()), mod.print());
   }
 }
 void Compiler::setPath(std::string path) { gameFolder = path; }
+void Compiler::setInstallMode(InstallMode mode) { installMode = mode; }
+
+void Compiler::setProgressCallback(
+    std::function<void(size_t, size_t, uintmax_t)> callback) {
+  progress = callback;
+}
+
+void Compiler::cancel() { cancelled = true; }
 
-bool Compiler::dependCheck(Mod mod) {
+void Compiler::reportProgress(uintmax_t bytes) {
+  std::lock_guard<std::mutex> lock(progressMutex);
+  filesDone++;
+  bytesDone += bytes;
+  if (progress) {
+    progress(filesDone, filesTotal, bytesDone);
+  }
+}
+
+bool Compiler::dependCheck(const Mod &mod) {
   bool failed = false;
   for (auto &dep : mod.dependencies) {
-    bool met = false;
-    if (!dependCheck(dep)) {
-      return false;
-    }
-
-    for (auto &compiled : compiledList) {
-      if (dep.name() != compiled.name()) {
-        continue;
-      }
-      if (dep.author() != compiled.author()) {
-        continue;
-      }
-      if (dep.version() != compiled.version()) {
-        if (dep.majorVersion() == "X") {
-          if (dep.minorVersion() == "X" ||
-              dep.minorVersion() == compiled.minorVersion()) {
-            log->appendLogMessage("---  Dependency found! : " +
-                                  compiled.printQString());
-            met = true;
-            break;
-          }
-        }
-        if (dep.minorVersion() == "X") {
-          if (dep.majorVersion() == "X" ||
-              dep.majorVersion() == compiled.majorVersion()) {
-            log->appendLogMessage("---  Dependency found! : " +
-                                  compiled.printQString());
-            met = true;
-            break;
-          }
+    // Compiled mods stay compiled, so an entry that was met once is never
+    // looked up again. Entries have no dependencies of their own, the mod
+    // meeting one had its dependencies checked when it was loaded.
+    std::string &memo = dependencyMemo[entryKey(dep)];
+    if (memo.empty()) {
+      // Only mods with the same name and author can satisfy it
+      for (auto compiled : compiledList.versions(dep)) {
+        if (dep.versionConstraint().matches(compiled->versionNumber())) {
+          memo = compiled->print();
+          break;
         }
       }
     }
-    if (!met) {
-      log->appendLogMessage("!! ERROR !! " + mod.printQString() +
-                            " is missing dependency " + dep.printQString());
+    const std::string &met = memo;
 
-      for (auto &modlist : modList) {
-        if (dep.name() != modlist.name()) {
-          continue;
-        }
-        if (dep.author() != modlist.author()) {
-          continue;
-        }
-        if (dep.version() != modlist.version()) {
-          if (dep.majorVersion() == "X") {
-            if (dep.minorVersion() == "X" ||
-                dep.minorVersion() == modlist.minorVersion()) {
-
-              log->appendLogMessage("\n!! FIX !! Incorrect load order! : " +
-                                    modlist.printQString() +
-                                    " must be compiled before " +
-                                    mod.printQString() + "!");
-              log->appendLogMessage(
-                  ">> Solution << Move " + modlist.printQString() + " above " +
-                  mod.printQString() + " in the active mods list!\n");
-
-              met = true;
-              break;
-            }
-          }
-          if (dep.minorVersion() == "X") {
-            if (dep.majorVersion() == "X" ||
-                dep.majorVersion() == modlist.majorVersion()) {
-
-              log->appendLogMessage("\n!! FIX !! Incorrect load order! : " +
-                                    modlist.printQString() +
-                                    " must be compiled before " +
-                                    mod.printQString() + "!");
-              log->appendLogMessage(
-                  ">> Solution << Move " + modlist.printQString() + " above " +
-                  mod.printQString() + " in the active mods list!\n");
-
-              met = true;
-              break;
-            }
-          }
-        }
-      }
+    if (!met.empty()) {
+      log->info("depend", "---  Dependency found! : " + quoted(met));
+    } else {
+      log->error("depend", "!! ERROR !! " + quoted(mod.print()) +
+                 " is missing dependency " + quoted(dep.print()), mod.print());
+
+      // The list is sorted, so a dependency in it would have been met
+      log->warning("depend", ">> Solution << Add a mod matching " +
+                   quoted(dep.print()) + " to the active mods list!\n",
+                   mod.print());
       failed = true;
     }
   }
@@ -192,42 +333,30 @@ bool Compiler::dependCheck(Mod mod) {
   }
 }
 
-bool Compiler::incompatibleCheck(Mod mod) {
+bool Compiler::incompatibleCheck(const Mod &mod) {
   bool failed = false;
   for (auto &incompatible : mod.incompatibilities) {
-    if (!incompatibleCheck(incompatible)) {
-      return false;
-    }
-
-    for (auto &modlist : modList) {
-      if (incompatible.name() != modlist.name()) {
-        continue;
-      }
-      if (incompatible.author() != modlist.author()) {
-        continue;
-      }
-      if (incompatible.version() != modlist.version()) {
-        if (incompatible.majorVersion() == "X") {
-          if (incompatible.minorVersion() == "X" ||
-              incompatible.minorVersion() == modlist.minorVersion()) {
-            log->appendLogMessage("!! ERROR !! " + mod.printQString() +
-                                  " is incompatible with " +
-                                  incompatible.printQString());
-            failed = true;
-            break;
-          }
-        }
-        if (incompatible.minorVersion() == "X") {
-          if (incompatible.majorVersion() == "X" ||
-              incompatible.majorVersion() == modlist.majorVersion()) {
-            log->appendLogMessage("!! ERROR !! " + mod.printQString() +
-                                  " is incompatible with " +
-                                  incompatible.printQString());
-            failed = true;
-            break;
-          }
+    // The mod list does not change during a compile, so each entry is looked
+    // up once however many mods share it
+    std::string key = entryKey(incompatible);
+    auto clash = incompatibleMemo.find(key);
+    if (clash == incompatibleMemo.end()) {
+      std::string found;
+      for (auto modlist : modIndex.versions(incompatible)) {
+        if (incompatible.versionConstraint().matches(
+                modlist->versionNumber())) {
+          found = modlist->print();
+          break;
         }
       }
+      clash = incompatibleMemo.emplace(key, found).first;
+    }
+
+    if (!clash->second.empty()) {
+      log->error("depend", "!! ERROR !! " + quoted(mod.print()) +
+                 " is incompatible with " + quoted(incompatible.print()),
+                 mod.print());
+      failed = true;
     }
   }
   if (failed) {
@@ -237,29 +366,17 @@ bool Compiler::incompatibleCheck(Mod mod) {
   }
 }
 
-bool Compiler::stageMod(Mod mod) {
-  log->appendLogMessage("-- Staging mod: " + mod.printQString());
-  std::filesystem::path stagingFolder =
-      std::filesystem::current_path() / "Staging";
+bool Compiler::overlayMod(const Mod &mod) {
+  log->info("stage", "-- Resolving files of mod: " + quoted(mod.print()),
+            mod.print());
 
   std::filesystem::path dataFolder = mod.path();
   dataFolder = dataFolder / "Data";
 
   try {
-    // Check if the directory exists
-    if (!std::filesystem::exists(stagingFolder) ||
-        !std::filesystem::is_directory(stagingFolder)) {
-      if (!std::filesystem::create_directory(stagingFolder)) {
-        log->appendLogMessage("!! ERROR !! Failed to create staging folder");
-        return false;
-      }
-      log->appendLogMessage("-- Created Staging Folder at " +
-                            QString(stagingFolder.c_str()));
-    }
-
     if (!std::filesystem::exists(dataFolder) ||
         !std::filesystem::is_directory(dataFolder)) {
-      log->appendLogMessage("!! ERROR !! Failed to find data Folder !");
+      log->error("stage", "!! ERROR !! Failed to find data Folder !");
       return false;
     }
 
@@ -267,54 +384,148 @@ bool Compiler::stageMod(Mod mod) {
          std::filesystem::recursive_directory_iterator(dataFolder)) {
       const auto &path = entry.path();
       auto relativePath = std::filesystem::relative(path, dataFolder);
-      auto destPath = stagingFolder / relativePath;
 
-      if (std::filesystem::is_directory(path)) {
-        // If it's a directory, create it in the destination if it does not
-        // exist
-        if (!std::filesystem::exists(destPath)) {
-          std::filesystem::create_directories(destPath);
+      if (entry.is_directory()) {
+        overlayFolders.insert(relativePath.generic_string());
+      } else if (entry.is_regular_file()) {
+        // Later mods win, so only the last mod providing a file is copied
+        OverlayFile &file = overlay[relativePath.generic_string()];
+        if (!file.mod.empty() && file.mod != mod.print()) {
+          conflicts[{file.mod, mod.print()}]++;
         }
-      } else if (std::filesystem::is_regular_file(path)) {
-        // If it's a file, move it to the destination
-        std::filesystem::copy(
-            path, destPath, std::filesystem::copy_options::overwrite_existing);
+        file = OverlayFile{path, entry.file_size(), mod.print(), ""};
       }
     }
 
   } catch (const std::filesystem::filesystem_error &e) {
-    log->appendLogMessage("\n!! ERROR !! STAGING FAILED : " +
-                          QString(e.what()));
+    log->error("stage", "\n!! ERROR !! STAGING FAILED : " +
+               std::string(e.what()));
+    return false;
+  } catch (const std::exception &e) {
+    log->error("stage", "\n!! ERROR !! STAGING FAILED : " +
+               std::string(e.what()));
     return false;
+  }
+  return true;
+}
+
+bool Compiler::stageOverlay() {
+  log->info("stage", "\n- Staging " + std::to_string(overlay.size()) +
+            " files");
+  std::filesystem::path stagingFolder =
+      std::filesystem::current_path() / "Staging";
+
+  std::atomic<bool> failed(false);
+  try {
+    // Check if the directory exists
+    if (!std::filesystem::exists(stagingFolder) ||
+        !std::filesystem::is_directory(stagingFolder)) {
+      if (!std::filesystem::create_directory(stagingFolder)) {
+        log->error("stage", "!! ERROR !! Failed to create staging folder");
+        return false;
+      }
+      log->info("stage", "-- Created Staging Folder at " +
+                stagingFolder.string(), "", stagingFolder.string());
+    }
+
+    // Sorted, so every folder comes after its parent
+    for (auto &folder : overlayFolders) {
+      std::filesystem::create_directories(stagingFolder / folder);
+    }
+
+    // Files the last install already put in this game folder are not staged
+    // again, inject finds them unchanged
+    bool current = manifest.load() && !manifest.gameFolder.empty() &&
+                   sameFolder(manifest.gameFolder, gameFolder);
+
+    // Every changed file is copied exactly once, from the mod that wins it
+    for (auto &[relative, file] : overlay) {
+      if (cancelled || failed) {
+        break;
+      }
+
+      pool.submit([this, &relative = relative, &file = file, stagingFolder,
+                   current, &failed]() {
+        if (cancelled || failed) {
+          return;
+        }
+        try {
+          file.hash = store.hashFile(file.source);
+          if (!file.hash.empty() && current &&
+              upToDate(relative, file.hash)) {
+            reportProgress(file.size);
+            return;
+          }
+          file.hash = store.stage(file.source, stagingFolder / relative);
+          if (file.hash.empty()) {
+            log->error("stage", "!! ERROR !! Failed to cache " +
+                       file.source.string(), "", file.source.string());
+            failed = true;
+            return;
+          }
+          reportProgress(file.size);
+        } catch (const std::exception &e) {
+          log->error("stage", "\n!! ERROR !! STAGING FAILED : " +
+                     std::string(e.what()));
+          failed = true;
+        }
+      });
+    }
+
+  } catch (const std::filesystem::filesystem_error &e) {
+    log->error("stage", "\n!! ERROR !! STAGING FAILED : " +
+               std::string(e.what()));
+    failed = true;
   } catch (const std::exception &e) {
-    log->appendLogMessage("\n!! ERROR !! STAGING FAILED : " +
-                          QString(e.what()));
+    log->error("stage", "\n!! ERROR !! STAGING FAILED : " +
+               std::string(e.what()));
+    failed = true;
+  }
+
+  pool.wait();
+  if (failed || cancelled) {
     return false;
   }
 
-  log->appendLogMessage("--- STAGING SUCCEEDED");
+  log->info("stage", "--- STAGING SUCCEEDED");
   return true;
 }
 
-bool Compiler::restoreSnapshot() {
+bool Compiler::restoreSnapshot(const std::filesystem::path &folder) {
   std::filesystem::path snapshotFolder =
       std::filesystem::current_path() / "Snapshot";
 
   // Check if the directory exists
   if (std::filesystem::exists(snapshotFolder) &&
       std::filesystem::is_directory(snapshotFolder)) {
-    log->appendLogMessage("-- Found Snapshot Folder at " +
-                          QString(snapshotFolder.c_str()));
+    log->info("restore", "-- Found Snapshot Folder at " +
+              snapshotFolder.string(), "", snapshotFolder.string());
   } else {
-    log->appendLogMessage("-- There is no snapshot folder!");
+    log->info("restore", "-- There is no snapshot folder!");
     return true;
   }
 
+  if (!sameFolder(folder, gameFolder)) {
+    log->info("restore", "-- Restoring previous game folder at " +
+              folder.string(), "", folder.string());
+  }
+
+  // Files the manifest knows about are put back or removed, so a dummy is
+  // never renamed over a file the last install added
+  std::vector<std::string> known;
+  for (auto &[relative, entry] : manifest.files) {
+    known.push_back(relative);
+  }
+  for (auto &relative : known) {
+    restoreFile(folder, relative);
+  }
+
+  // Anything left was snapshotted without a manifest entry
   for (const auto &entry :
        std::filesystem::recursive_directory_iterator(snapshotFolder)) {
     const auto &path = entry.path();
     auto relativePath = std::filesystem::relative(path, snapshotFolder);
-    auto destPath = gameFolder / relativePath;
+    auto destPath = folder / relativePath;
 
     if (std::filesystem::is_directory(path)) {
       // If it's a directory, create it in the destination if it does not
@@ -324,107 +535,355 @@ bool Compiler::restoreSnapshot() {
       }
     } else if (std::filesystem::is_regular_file(path)) {
       // If it's a file, move it to the destination
-      log->appendLogMessage("--- Restoring " + QString(path.c_str()));
-      std::filesystem::rename(path, destPath);
+      log->info("restore", "--- Restoring " + path.string(), "", path.string());
+      moveFile(path, destPath);
     }
   }
-  log->appendLogMessage("-- Successfully restored snapshot");
-  log->appendLogMessage("-- Deleting old snapshot folder.");
+  log->info("restore", "-- Successfully restored snapshot");
+  log->info("restore", "-- Deleting old snapshot folder.");
   std::filesystem::remove_all(snapshotFolder);
+
+  // The game folder is back to its original state
+  manifest.clear();
+  manifest.gameFolder = folder.string();
+  manifest.save();
+  return true;
+}
+
+bool Compiler::restoreFile(const std::filesystem::path &folder,
+                           const std::string &relative) {
+  std::filesystem::path snapshotFolder =
+      std::filesystem::current_path() / "Snapshot";
+
+  bool original;
+  {
+    std::lock_guard<std::mutex> lock(manifestMutex);
+    auto entry = manifest.files.find(relative);
+    if (entry == manifest.files.end()) {
+      return true;
+    }
+    original = entry->second.original;
+  }
+
+  auto destPath = folder / relative;
+  auto snapshotPath = snapshotFolder / relative;
+
+  if (!std::filesystem::exists(snapshotPath)) {
+    log->warning("restore", "--- ! Missing snapshot of " + destPath.string() +
+                 ", leaving as is !", "", destPath.string());
+  } else if (original) {
+    log->info("restore", "--- Restoring " + snapshotPath.string(), "",
+              snapshotPath.string());
+    moveFile(snapshotPath, destPath);
+  } else {
+    // The file did not exist before it was injected
+    log->info("restore", "--- Removing " + destPath.string(), "",
+              destPath.string());
+    std::filesystem::remove(destPath);
+    std::filesystem::remove(snapshotPath);
+  }
+
+  std::lock_guard<std::mutex> lock(manifestMutex);
+  manifest.files.erase(relative);
+  return true;
+}
+
+bool Compiler::upToDate(const std::string &relative, const std::string &hash) {
+  Manifest::Entry installed;
+  {
+    std::lock_guard<std::mutex> lock(manifestMutex);
+    auto it = manifest.files.find(relative);
+    if (it == manifest.files.end()) {
+      return false;
+    }
+    installed = it->second;
+  }
+
+  // The content is in place as long as nothing has modified the file since
+  // the last install
+  auto destPath = gameFolder / relative;
+  return installed.hash == hash && std::filesystem::exists(destPath) &&
+         std::filesystem::file_size(destPath) == installed.size &&
+         std::filesystem::last_write_time(destPath)
+                 .time_since_epoch()
+                 .count() == installed.mtime;
+}
+
+bool Compiler::injectFile(const std::filesystem::path &relativePath) {
+  std::filesystem::path stagingFolder =
+      std::filesystem::current_path() / "Staging";
+  std::filesystem::path snapshotFolder =
+      std::filesystem::current_path() / "Snapshot";
+
+  auto path = stagingFolder / relativePath;
+  auto destPath = gameFolder / relativePath;
+  auto snapshotPath = snapshotFolder / relativePath;
+  std::string relative = relativePath.generic_string();
+
+  // Each file is only ever handled by one task, so no lock is needed
+  OverlayFile &staged = overlay.at(relative);
+  if (staged.hash.empty()) {
+    // Not staged, hash the mod file itself
+    staged.hash = store.hashFile(staged.source);
+    if (staged.hash.empty()) {
+      log->error("inject", "!! ERROR !! Failed to hash " +
+                 staged.source.string(), "", staged.source.string());
+      return false;
+    }
+  }
+
+  bool known = false;
+  Manifest::Entry installed{};
+  {
+    std::lock_guard<std::mutex> lock(manifestMutex);
+    auto it = manifest.files.find(relative);
+    if (it != manifest.files.end()) {
+      known = true;
+      installed = it->second;
+    }
+  }
+
+  if (known) {
+    // Skip files whose content is already in place
+    if (upToDate(relative, staged.hash)) {
+      {
+        std::lock_guard<std::mutex> lock(manifestMutex);
+        manifest.files[relative].mod = staged.mod;
+      }
+      unchangedFiles++;
+      reportProgress(staged.size);
+      return true;
+    }
+    // The original is already in the snapshot, just replace the file
+    log->info("inject", "--- Updating " + destPath.string(), "",
+              destPath.string());
+  } else {
+    log->info("inject", "--- Injecting " + staged.source.string(), "",
+              staged.source.string());
+  }
+
+  // Removes the temporary copy on every way out that does not rename it
+  struct Leftover {
+    std::filesystem::path path;
+    ~Leftover() {
+      if (!path.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+      }
+    }
+  } leftover;
+
+  std::filesystem::path incoming = path;
+  if (installMode == InstallMode::Direct) {
+    // Write next to the destination and rename over it, so the game file is
+    // never seen half written
+    incoming = destPath;
+    incoming += ".bmltmp";
+    leftover.path = incoming;
+    // A hardlink would make the game file and the mod file one file
+    cloneFile(staged.source, incoming, false);
+  } else if (!std::filesystem::exists(incoming)) {
+    // Left out of staging as installed, but changed since
+    store.stage(staged.source, incoming);
+  }
+
+  if (!known) {
+    installed.original = std::filesystem::exists(destPath);
+    if (installed.original) {
+      // Move the original out of the way instead of copying it, the new file
+      // takes its place right after
+      log->info("inject", "--- Moving original to snapshot " +
+                snapshotPath.string(), "", snapshotPath.string());
+      moveFile(destPath, snapshotPath);
+    } else {
+      log->info("inject", "--- Saving dummy to " + snapshotPath.string(), "",
+                snapshotPath.string());
+      std::ofstream f(snapshotPath);
+      if (!f) {
+        log->error("inject", "\n ** ERROR ** Failed to create dummy file at " +
+                   snapshotPath.string(), "", snapshotPath.string());
+        return false;
+      }
+      f.close();
+    }
+
+    // Record the snapshot before touching the game file so a failure from
+    // here on still leaves it owned by this install
+    std::lock_guard<std::mutex> lock(manifestMutex);
+    manifest.files[relative] = installed;
+  }
+
+  moveFile(incoming, destPath);
+  leftover.path.clear();
+  installed.size = staged.size;
+  installed.mtime =
+      std::filesystem::last_write_time(destPath).time_since_epoch().count();
+  installed.hash = staged.hash;
+  installed.mod = staged.mod;
+  {
+    std::lock_guard<std::mutex> lock(manifestMutex);
+    manifest.files[relative] = installed;
+  }
+  reportProgress(staged.size);
   return true;
 }
 
 bool Compiler::inject() {
-  log->appendLogMessage("\n- BEGINNING INJECTION");
+  log->info("inject", "\n- BEGINNING INJECTION");
   try {
     // Check if the directory exists
     if (std::filesystem::exists(gameFolder) &&
         std::filesystem::is_directory(gameFolder)) {
-      log->appendLogMessage("-- Found Game Folder at " +
-                            QString(gameFolder.c_str()));
+      log->info("inject", "-- Found Game Folder at " + gameFolder.string(), "",
+                gameFolder.string());
     } else {
-      log->appendLogMessage(
+      log->error(
+          "inject",
           "\n!! ERROR !! INJECTION FAILED : Failed to open game folder!");
       return false;
     }
 
-    if (!restoreSnapshot()) {
-      log->appendLogMessage(
+    if (sameFilesystem(gameFolder, std::filesystem::current_path())) {
+      log->info("inject", "-- Game folder shares a filesystem with BML, "
+                          "files and snapshots will be renamed into place");
+    } else {
+      log->info("inject", "-- Game folder is on another filesystem, staged "
+                          "files and snapshots will be copied across");
+    }
+
+    // A manifest for another game folder means the snapshot belongs there, so
+    // that folder is restored before anything is installed into this one.
+    // Without a manifest nothing is known about what the last install wrote,
+    // so fall back to restoring the whole snapshot.
+    bool loaded = manifest.load();
+    std::filesystem::path previous = gameFolder;
+    if (loaded && !manifest.gameFolder.empty()) {
+      previous = manifest.gameFolder;
+    }
+    if (loaded && !manifest.gameFolder.empty() &&
+        sameFolder(manifest.gameFolder, gameFolder)) {
+      log->info("inject", "-- Found install manifest with " +
+                std::to_string(manifest.files.size()) +
+                " files, applying changes only");
+    } else if (!restoreSnapshot(previous)) {
+      log->error(
+          "inject",
           "\n!! ERROR !! INJECTION FAILED : Failed to restore snapshot!");
       return false;
     }
+    manifest.gameFolder = gameFolder.string();
+  } catch (const std::filesystem::filesystem_error &e) {
+    log->error("inject", "\n!! ERROR !! INJECTION FAILED : " +
+               std::string(e.what()));
+    return false;
+  } catch (const std::exception &e) {
+    log->error("inject", "\n!! ERROR !! INJECTION FAILED : " +
+               std::string(e.what()));
+    return false;
+  }
 
-    std::filesystem::path stagingFolder =
-        std::filesystem::current_path() / "Staging";
-
+  std::atomic<bool> failed(false);
+  unchangedFiles = 0;
+  try {
     std::filesystem::path snapshotFolder =
         std::filesystem::current_path() / "Snapshot";
 
     if (std::filesystem::exists(snapshotFolder) &&
         std::filesystem::is_directory(snapshotFolder)) {
-      log->appendLogMessage("-- Found Snapshot Folder at " +
-                            QString(snapshotFolder.c_str()));
+      log->info("inject", "-- Found Snapshot Folder at " +
+                snapshotFolder.string(), "", snapshotFolder.string());
     } else {
       if (!std::filesystem::create_directory(snapshotFolder)) {
-        log->appendLogMessage("!! ERROR !! Failed to create snapshot folder");
+        log->error("inject", "!! ERROR !! Failed to create snapshot folder");
         return false;
       }
-      log->appendLogMessage("-- Created empty Snapshot Folder at " +
-                            QString(snapshotFolder.c_str()));
+      log->info("inject", "-- Created empty Snapshot Folder at " +
+                snapshotFolder.string(), "", snapshotFolder.string());
     }
 
-    for (const auto &entry :
-         std::filesystem::recursive_directory_iterator(stagingFolder)) {
-      const auto &path = entry.path();
-      auto relativePath = std::filesystem::relative(path, stagingFolder);
-      auto destPath = gameFolder / relativePath;
-      auto snapshotPath = snapshotFolder / relativePath;
-
-      if (std::filesystem::is_directory(path)) {
-        // If it's a directory, create it in the destination if it does not
-        // exist
-        if (!std::filesystem::exists(destPath)) {
-          std::filesystem::create_directories(destPath);
+    // Put back every file the last install wrote that is no longer staged
+    std::vector<std::string> removed;
+    for (auto &[relative, entry] : manifest.files) {
+      if (overlay.find(relative) == overlay.end()) {
+        removed.push_back(relative);
+      }
+    }
+    for (auto &relative : removed) {
+      pool.submit([this, relative, &failed]() {
+        try {
+          restoreFile(gameFolder, relative);
+        } catch (const std::exception &e) {
+          log->error("inject", "\n!! ERROR !! RESTORE FAILED : " +
+                     std::string(e.what()));
+          failed = true;
         }
-        if (!std::filesystem::exists(snapshotPath)) {
-          std::filesystem::create_directories(snapshotPath);
+      });
+    }
+    pool.wait();
+
+    // Sorted, so every folder comes after its parent
+    for (auto &folder : overlayFolders) {
+      auto destPath = gameFolder / folder;
+      auto snapshotPath = snapshotFolder / folder;
+
+      // Create it in the destination if it does not exist
+      if (!std::filesystem::exists(destPath)) {
+        std::filesystem::create_directories(destPath);
+      }
+      if (!std::filesystem::exists(snapshotPath)) {
+        std::filesystem::create_directories(snapshotPath);
+      }
+    }
+
+    // Folders are all created above, so the files themselves can go to the
+    // pool in any order
+    for (auto &[relative, file] : overlay) {
+      if (cancelled || failed) {
+        break;
+      }
+
+      std::filesystem::path relativePath = relative;
+      pool.submit([this, relativePath, &failed]() {
+        if (cancelled || failed) {
+          return;
         }
-      } else if (std::filesystem::is_regular_file(path)) {
-        // If it's a file, move it to the destination
-        log->appendLogMessage("--- Injecting " + QString(path.c_str()));
-
-        if (std::filesystem::exists(destPath)) {
-          log->appendLogMessage("--- Saving snapshot to " +
-                                QString(snapshotPath.c_str()));
-          std::filesystem::copy(
-              destPath, snapshotPath,
-              std::filesystem::copy_options::overwrite_existing);
-        } else {
-          log->appendLogMessage("--- Saving dummy to " +
-                                QString(snapshotPath.c_str()));
-          std::ofstream f(snapshotPath);
-          if (!f) {
-            log->appendLogMessage(
-                "\n ** ERROR ** Failed to create dummy file at " +
-                QString(snapshotPath.c_str()));
-            return false;
+        try {
+          if (!injectFile(relativePath)) {
+            failed = true;
           }
-          f.close();
+        } catch (const std::exception &e) {
+          log->error("inject", "\n!! ERROR !! INJECTION FAILED : " +
+                     std::string(e.what()));
+          failed = true;
         }
-
-        std::filesystem::rename(path, destPath);
-      }
+      });
     }
   } catch (const std::filesystem::filesystem_error &e) {
-    log->appendLogMessage("\n!! ERROR !! INJECTION FAILED : " +
-                          QString(e.what()));
-    return false;
+    log->error("inject", "\n!! ERROR !! INJECTION FAILED : " +
+               std::string(e.what()));
+    failed = true;
   } catch (const std::exception &e) {
-    log->appendLogMessage("\n!! ERROR !! INJECTION FAILED : " +
-                          QString(e.what()));
-    return false;
+    log->error("inject", "\n!! ERROR !! INJECTION FAILED : " +
+               std::string(e.what()));
+    failed = true;
   }
-  return true;
+
+  pool.wait();
+  if (unchangedFiles > 0) {
+    log->info("inject", "-- Skipped " + std::to_string(unchangedFiles) +
+              " unchanged files");
+  }
+
+  // Always record what was written, even after a failure, so the next install
+  // knows which snapshot entries belong to it
+  try {
+    manifest.save();
+  } catch (const std::exception &e) {
+    log->error("inject", "!! ERROR !! Failed to save install manifest : " +
+               std::string(e.what()));
+    failed = true;
+  }
+  return !failed && !cancelled;
 }
 
 } // namespace BML
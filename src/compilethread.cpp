@@ -0,0 +1,24 @@
+#include "compilethread.h"
+
+namespace BML {
+
+CompileThread::CompileThread(Compiler *compiler, QObject *parent)
+    : QThread(parent), compiler(compiler) {
+  compiler->setProgressCallback(
+      [this](size_t done, size_t total, uintmax_t bytes) {
+        // Limit updates to what the progress bar can show, one queued signal
+        // per file would flood the GUI event loop
+        if (done != total && throttle.isValid() && throttle.elapsed() < 30) {
+          return;
+        }
+        throttle.restart();
+        emit progress(done, total, bytes);
+      });
+}
+
+void CompileThread::run() {
+  throttle.invalidate();
+  emit compiled(compiler->compile());
+}
+
+} // namespace BML
@@ -0,0 +1,122 @@
+#include "fileops.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+namespace BML {
+
+static std::filesystem::path existingPath(std::filesystem::path path) {
+  path = std::filesystem::absolute(path);
+  while (!std::filesystem::exists(path) && path.has_relative_path()) {
+    path = path.parent_path();
+  }
+  return path;
+}
+
+bool sameFilesystem(const std::filesystem::path &a,
+                    const std::filesystem::path &b) {
+  std::filesystem::path first = existingPath(a);
+  std::filesystem::path second = existingPath(b);
+
+#ifdef _WIN32
+  // Hardlinks and renames work within one volume
+  return first.root_name() == second.root_name();
+#else
+  struct stat firstStat;
+  struct stat secondStat;
+  if (stat(first.c_str(), &firstStat) != 0 ||
+      stat(second.c_str(), &secondStat) != 0) {
+    return false;
+  }
+  return firstStat.st_dev == secondStat.st_dev;
+#endif
+}
+
+bool reflinkFile(const std::filesystem::path &source,
+                 const std::filesystem::path &dest) {
+#if defined(__linux__) && defined(FICLONE)
+  int in = open(source.c_str(), O_RDONLY);
+  if (in < 0) {
+    return false;
+  }
+
+  struct stat sourceStat;
+  if (fstat(in, &sourceStat) != 0) {
+    close(in);
+    return false;
+  }
+
+  int out = open(dest.c_str(), O_WRONLY | O_CREAT | O_EXCL,
+                 sourceStat.st_mode & 0777);
+  if (out < 0) {
+    close(in);
+    return false;
+  }
+
+  bool cloned = ioctl(out, FICLONE, in) == 0;
+  close(out);
+  close(in);
+  if (!cloned) {
+    unlink(dest.c_str());
+  }
+  return cloned;
+#else
+  (void)source;
+  (void)dest;
+  return false;
+#endif
+}
+
+CopyMethod cloneFile(const std::filesystem::path &source,
+                     const std::filesystem::path &dest, bool allowHardlink) {
+  if (std::filesystem::exists(dest)) {
+    std::filesystem::remove(dest);
+  }
+
+  if (sameFilesystem(source, dest.parent_path())) {
+    if (reflinkFile(source, dest)) {
+      return CopyMethod::Reflink;
+    }
+
+    std::error_code ec;
+    if (allowHardlink) {
+      std::filesystem::create_hard_link(source, dest, ec);
+      if (!ec) {
+        return CopyMethod::Hardlink;
+      }
+    }
+  }
+
+  std::filesystem::copy_file(source, dest);
+  return CopyMethod::Copy;
+}
+
+bool moveFile(const std::filesystem::path &source,
+              const std::filesystem::path &dest) {
+  std::error_code ec;
+  std::filesystem::rename(source, dest, ec);
+  if (!ec) {
+    return true;
+  }
+  if (ec != std::errc::cross_device_link) {
+    throw std::filesystem::filesystem_error("rename", source, dest, ec);
+  }
+
+  std::filesystem::path tmpPath = dest;
+  tmpPath += ".bmltmp";
+  std::filesystem::copy_file(source, tmpPath,
+                             std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::rename(tmpPath, dest);
+  std::filesystem::remove(source);
+  return false;
+}
+
+} // namespace BML
@@ -0,0 +1,169 @@
+#include "gamefinder.h"
+#include <deque>
+#include <fstream>
+#include <regex>
+#include <set>
+
+namespace BML {
+
+std::filesystem::path getUserHomeDirectory() {
+  const char *homeDir = std::getenv("HOME"); // For Unix-based systems
+
+  if (homeDir) {
+    return std::filesystem::path(homeDir);
+  } else {
+    // Fallback for Windows
+    homeDir = std::getenv("USERPROFILE");
+    if (homeDir) {
+      return std::filesystem::path(homeDir);
+    } else {
+      // Further fallback if necessary
+      return std::filesystem::path();
+    }
+  }
+}
+
+// Extra Steam libraries are listed as "path" entries in libraryfolders.vdf
+static std::vector<std::filesystem::path>
+steamLibraries(const std::filesystem::path &steamDir) {
+  std::vector<std::filesystem::path> libraries;
+
+  std::ifstream f(steamDir / "steamapps" / "libraryfolders.vdf");
+  if (!f.is_open()) {
+    return libraries;
+  }
+
+  std::regex pathEntry("\"path\"\\s+\"(.+)\"");
+  std::string line;
+  while (std::getline(f, line)) {
+    std::smatch match;
+    if (std::regex_search(line, match, pathEntry)) {
+      // Windows paths are stored with escaped backslashes
+      std::string library =
+          std::regex_replace(match[1].str(), std::regex("\\\\\\\\"), "/");
+      libraries.push_back(library);
+    }
+  }
+  return libraries;
+}
+
+std::vector<std::filesystem::path>
+knownGameFolders(const std::filesystem::path &homeDir) {
+  std::vector<std::filesystem::path> steamDirs = {
+      "C:/Program Files (x86)/Steam",
+      "C:/Program Files/Steam",
+  };
+  std::vector<std::filesystem::path> candidates = {
+      "C:/GOG Games/Borderlands",
+      "C:/Program Files (x86)/GOG Galaxy/Games/Borderlands",
+  };
+
+  if (!homeDir.empty()) {
+    steamDirs.push_back(homeDir / ".steam" / "steam");
+    steamDirs.push_back(homeDir / ".local" / "share" / "Steam");
+    steamDirs.push_back(homeDir / ".var" / "app" / "com.valvesoftware.Steam" /
+                        ".local" / "share" / "Steam");
+    steamDirs.push_back(homeDir / ".wine" / "drive_c" /
+                        "Program Files (x86)" / "Steam");
+    steamDirs.push_back(homeDir / ".wine" / "drive_c" / "Program Files" /
+                        "Steam");
+
+    candidates.push_back(homeDir / "GOG Games" / "Borderlands");
+    candidates.push_back(homeDir / "Games" / "Borderlands");
+    candidates.push_back(homeDir / "Games" / "Heroic" / "Borderlands");
+    candidates.push_back(homeDir / ".wine" / "drive_c" / "GOG Games" /
+                         "Borderlands");
+  }
+
+  std::vector<std::filesystem::path> folders;
+  for (auto &steamDir : steamDirs) {
+    folders.push_back(steamDir / "steamapps" / "common" / "Borderlands");
+    for (auto &library : steamLibraries(steamDir)) {
+      folders.push_back(library / "steamapps" / "common" / "Borderlands");
+    }
+  }
+  folders.insert(folders.end(), candidates.begin(), candidates.end());
+  return folders;
+}
+
+bool findBorderlandsGameFolder(
+    const std::filesystem::path &startDir, std::filesystem::path &foundPath,
+    size_t maxDepth, std::chrono::steady_clock::time_point deadline,
+    const std::function<bool()> &stop) {
+  // Large trees that never contain a game install
+  static const std::set<std::string> skipped = {
+      "cache", "Cache", "node_modules", "snap", "Library", "AppData"};
+
+  std::error_code ec;
+  if (!std::filesystem::is_directory(startDir, ec)) {
+    return false;
+  }
+
+  // Breadth-first, so shallow installs are found before deep trees are walked
+  std::deque<std::pair<std::filesystem::path, size_t>> queue;
+  queue.push_back({startDir, 0});
+
+  while (!queue.empty()) {
+    if (std::chrono::steady_clock::now() > deadline || (stop && stop())) {
+      return false;
+    }
+
+    auto [dir, depth] = queue.front();
+    queue.pop_front();
+
+    std::filesystem::directory_iterator it(
+        dir, std::filesystem::directory_options::skip_permission_denied, ec);
+    if (ec) {
+      continue;
+    }
+
+    for (; it != std::filesystem::directory_iterator(); it.increment(ec)) {
+      if (ec) {
+        break;
+      }
+      if (!it->is_directory(ec) || it->is_symlink(ec)) {
+        continue;
+      }
+
+      std::string name = it->path().filename().string();
+      if (name == "Borderlands") {
+        foundPath = it->path();
+        return true;
+      }
+      if (name.empty() || name[0] == '.' || skipped.count(name) ||
+          depth + 1 >= maxDepth) {
+        continue;
+      }
+      queue.push_back({it->path(), depth + 1});
+    }
+  }
+
+  return false;
+}
+
+GameFinderThread::GameFinderThread(QObject *parent) : QThread(parent) {}
+
+void GameFinderThread::run() {
+  std::filesystem::path homeDir = getUserHomeDirectory();
+
+  std::error_code ec;
+  for (auto &folder : knownGameFolders(homeDir)) {
+    if (std::filesystem::is_directory(folder, ec)) {
+      emit found(QString(folder.c_str()));
+      return;
+    }
+  }
+
+  std::filesystem::path foundPath;
+  if (!homeDir.empty() &&
+      findBorderlandsGameFolder(
+          homeDir, foundPath, 6,
+          std::chrono::steady_clock::now() + std::chrono::seconds(10),
+          [this]() { return isInterruptionRequested(); })) {
+    emit found(QString(foundPath.c_str()));
+    return;
+  }
+  emit notFound();
+}
+
+} // namespace BML
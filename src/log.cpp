@@ -0,0 +1,238 @@
+#include "log.h"
+#include "json.hpp"
+#include <algorithm>
+#include <cstdio>
+
+using json = nlohmann::json;
+
+namespace BML {
+
+const char *logLevelName(LogLevel level) {
+  switch (level) {
+  case LogLevel::Debug:
+    return "debug";
+  case LogLevel::Info:
+    return "info";
+  case LogLevel::Warning:
+    return "warning";
+  case LogLevel::Error:
+    return "error";
+  }
+  return "info";
+}
+
+StreamSink::StreamSink(std::ostream &stream, LogLevel minLevel)
+    : stream(stream), minLevel(minLevel) {}
+
+void StreamSink::write(const std::vector<LogRecord> &records) {
+  for (auto &record : records) {
+    if (record.level >= minLevel) {
+      stream << record.message << "\n";
+    }
+  }
+  stream.flush();
+}
+
+RotatingFileSink::RotatingFileSink(std::filesystem::path file,
+                                   uintmax_t maxBytes, size_t maxFiles)
+    : file(file), maxBytes(maxBytes), maxFiles(std::max<size_t>(maxFiles, 1)),
+      written(0), rotations(0) {
+  // Keep the previous session around as file.1
+  if (std::filesystem::exists(file)) {
+    rotate();
+    rotations = 0;
+  } else {
+    out.open(file, std::ios::trunc);
+  }
+}
+
+RotatingFileSink::~RotatingFileSink() { out.close(); }
+
+void RotatingFileSink::rotate() {
+  out.close();
+
+  std::error_code error;
+  for (size_t i = maxFiles - 1; i > 0; i--) {
+    std::filesystem::path from = file;
+    if (i > 1) {
+      from += "." + std::to_string(i - 1);
+    }
+    std::filesystem::path to = file;
+    to += "." + std::to_string(i);
+    if (std::filesystem::exists(from, error)) {
+      std::filesystem::rename(from, to, error);
+    }
+  }
+
+  out.open(file, std::ios::trunc);
+  written = 0;
+  rotations++;
+}
+
+void RotatingFileSink::write(const std::vector<LogRecord> &records) {
+  if (!out.is_open()) {
+    return;
+  }
+
+  for (auto &record : records) {
+    std::string line = format(record);
+    if (written > 0 && written + line.size() > maxBytes) {
+      rotate();
+    }
+    out << line;
+    written += line.size();
+  }
+  out.flush();
+}
+
+std::vector<std::filesystem::path> RotatingFileSink::sessionFiles() {
+  std::vector<std::filesystem::path> files;
+  for (size_t i = std::min(rotations, maxFiles - 1); i > 0; i--) {
+    std::filesystem::path rotated = file;
+    rotated += "." + std::to_string(i);
+    files.push_back(rotated);
+  }
+  files.push_back(file);
+  return files;
+}
+
+std::string RotatingFileSink::format(const LogRecord &record) {
+  char prefix[64];
+  std::snprintf(prefix, sizeof(prefix), "[%10.3f] %-7s %s: ",
+                record.elapsed / 1000.0, logLevelName(record.level),
+                record.subsystem.c_str());
+  return prefix + record.message + "\n";
+}
+
+std::string JsonLinesSink::format(const LogRecord &record) {
+  json line = {{"seq", record.sequence},
+               {"elapsed", record.elapsed},
+               {"level", logLevelName(record.level)},
+               {"subsystem", record.subsystem},
+               {"message", record.message}};
+  if (!record.mod.empty()) {
+    line["mod"] = record.mod;
+  }
+  if (!record.path.empty()) {
+    line["path"] = record.path;
+  }
+  return line.dump(-1, ' ', false, json::error_handler_t::replace) + "\n";
+}
+
+Log::Log()
+    : start(std::chrono::steady_clock::now()), sequence(0), head(nullptr),
+      stopping(false) {
+  worker = std::thread([this]() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    while (!stopping) {
+      wake.wait(lock, [this]() {
+        return stopping || head.load(std::memory_order_relaxed) != nullptr;
+      });
+      lock.unlock();
+      flush();
+      lock.lock();
+    }
+  });
+}
+
+Log::~Log() { stop(); }
+
+void Log::addSink(LogSink *sink) {
+  std::lock_guard<std::mutex> lock(sinkMutex);
+  sinks.push_back(sink);
+}
+
+void Log::removeSink(LogSink *sink) {
+  std::lock_guard<std::mutex> lock(sinkMutex);
+  sinks.erase(std::remove(sinks.begin(), sinks.end(), sink), sinks.end());
+}
+
+void Log::write(LogLevel level, const std::string &subsystem,
+                const std::string &message, const std::string &mod,
+                const std::string &path) {
+  int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  Node *node = new Node{LogRecord{sequence++, level, elapsed, subsystem, mod,
+                                  path, message},
+                        nullptr};
+  // The node may be flushed and freed as soon as it is pushed, so the
+  // previous head is kept here rather than read back from it
+  Node *next = head.load(std::memory_order_relaxed);
+  do {
+    node->next = next;
+  } while (!head.compare_exchange_weak(next, node, std::memory_order_release,
+                                       std::memory_order_relaxed));
+
+  // Only the first record of a batch wakes the worker. Passing through the
+  // mutex keeps the wake from landing between its check and its wait.
+  if (!next) {
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wake.notify_one();
+  }
+}
+
+void Log::debug(const std::string &subsystem, const std::string &message,
+                const std::string &mod, const std::string &path) {
+  write(LogLevel::Debug, subsystem, message, mod, path);
+}
+
+void Log::info(const std::string &subsystem, const std::string &message,
+               const std::string &mod, const std::string &path) {
+  write(LogLevel::Info, subsystem, message, mod, path);
+}
+
+void Log::warning(const std::string &subsystem, const std::string &message,
+                  const std::string &mod, const std::string &path) {
+  write(LogLevel::Warning, subsystem, message, mod, path);
+}
+
+void Log::error(const std::string &subsystem, const std::string &message,
+                const std::string &mod, const std::string &path) {
+  write(LogLevel::Error, subsystem, message, mod, path);
+}
+
+void Log::flush() {
+  // Taking the list under the sink lock keeps two flushes from delivering
+  // their batches out of order
+  std::lock_guard<std::mutex> lock(sinkMutex);
+  Node *node = head.exchange(nullptr, std::memory_order_acquire);
+  if (!node) {
+    return;
+  }
+
+  std::vector<LogRecord> records;
+  while (node) {
+    records.push_back(std::move(node->record));
+    Node *next = node->next;
+    delete node;
+    node = next;
+  }
+
+  // Threads may win the push in a different order than they took their
+  // sequence numbers
+  std::sort(records.begin(), records.end(),
+            [](const LogRecord &a, const LogRecord &b) {
+              return a.sequence < b.sequence;
+            });
+
+  for (auto sink : sinks) {
+    sink->write(records);
+  }
+}
+
+void Log::stop() {
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+  flush();
+}
+
+} // namespace BML
@@ -1,22 +1,93 @@
 #include "logger.h"
 #include <QScrollBar>
+#include <QThread>
+#include <filesystem>
 
 namespace BML {
 
 Logger::Logger(QWidget *parent)
-    : QWidget(parent), textEdit(new QTextEdit(this)) {
+    : QWidget(parent), textEdit(new QPlainTextEdit(this)),
+      flushTimer(new QTimer(this)),
+      fileSink(std::filesystem::current_path() / "bml.log", maxFileSize,
+               maxFiles),
+      jsonSink(std::filesystem::current_path() / "bml.jsonl", maxFileSize,
+               maxFiles) {
   textEdit->setReadOnly(true);
+  textEdit->setMaximumBlockCount(maxLines);
   QVBoxLayout *layout = new QVBoxLayout(this);
   layout->addWidget(textEdit);
   setLayout(layout);
+
+  flushTimer->setSingleShot(true);
+  flushTimer->setInterval(flushInterval);
+  connect(flushTimer, &QTimer::timeout, this, &Logger::flush);
+
+  log.addSink(this);
+  log.addSink(&fileSink);
+  log.addSink(&jsonSink);
 }
 
+Logger::~Logger() { log.stop(); }
+
+Log *Logger::backend() { return &log; }
+
 void Logger::appendLogMessage(const QString &message) {
-  textEdit->append(message);
+  // Messages from the window carry their severity in the text
+  LogLevel level = LogLevel::Info;
+  if (message.contains("ERROR")) {
+    level = LogLevel::Error;
+  } else if (message.contains("!!")) {
+    level = LogLevel::Warning;
+  }
+  log.write(level, "window", message.toStdString());
+}
+
+void Logger::write(const std::vector<LogRecord> &records) {
+  bool wasEmpty;
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    wasEmpty = pending.isEmpty();
+    for (auto &record : records) {
+      pending.append(QString::fromStdString(record.message));
+    }
+  }
+
+  // Only the first batch arms the timer, and the timer lives in the GUI thread
+  if (wasEmpty) {
+    QMetaObject::invokeMethod(flushTimer, "start", Qt::QueuedConnection);
+  }
+}
+
+void Logger::flush() {
+  QStringList messages;
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    messages.swap(pending);
+  }
+  if (messages.isEmpty()) {
+    return;
+  }
+
+  // Lines beyond maxLines are dropped from the top by the widget itself
+  textEdit->appendPlainText(messages.join("\n"));
   textEdit->verticalScrollBar()->setValue(
       textEdit->verticalScrollBar()->maximum());
 }
 
-QString Logger::exportLog() { return textEdit->toPlainText(); }
+bool Logger::exportLog(const QString &fileName) {
+  log.flush();
+
+  std::ofstream out(fileName.toStdString(), std::ios::trunc);
+  if (!out) {
+    return false;
+  }
+  for (auto &file : fileSink.sessionFiles()) {
+    std::ifstream in(file);
+    if (in) {
+      out << in.rdbuf();
+    }
+  }
+  return static_cast<bool>(out);
+}
 
 } // namespace BML
@@ -1,7 +1,13 @@
+#include "cli.h"
 #include "window.h"
 #include <QApplication>
 
 int main(int argc, char *argv[]) {
+  // A command or one of its options selects the headless mode
+  if (BML::isCliCommand(argc, argv)) {
+    return BML::runCli(argc, argv);
+  }
+
   QApplication app(argc, argv);
   BML::Window window;
   window.show();
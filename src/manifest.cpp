@@ -0,0 +1,67 @@
+#include "manifest.h"
+#include "json.hpp"
+#include <fstream>
+
+using json = nlohmann::json;
+
+namespace BML {
+
+Manifest::Manifest(std::filesystem::path file) : file(file) {}
+
+Manifest::~Manifest() {}
+
+bool Manifest::load() {
+  clear();
+
+  std::ifstream f(file);
+  if (!f.is_open()) {
+    return false;
+  }
+
+  try {
+    json data = json::parse(f);
+    gameFolder = data.at("game").get<std::string>();
+    for (auto &[path, entry] : data.at("files").items()) {
+      files[path] = Entry{entry.at("size").get<uintmax_t>(),
+                          entry.at("mtime").get<int64_t>(),
+                          entry.at("hash").get<std::string>(),
+                          entry.at("mod").get<std::string>(),
+                          entry.at("original").get<bool>()};
+    }
+  } catch (const std::exception &e) {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+bool Manifest::save() {
+  json entries = json::object();
+  for (auto &[path, entry] : files) {
+    entries[path] = {{"size", entry.size},
+                     {"mtime", entry.mtime},
+                     {"hash", entry.hash},
+                     {"mod", entry.mod},
+                     {"original", entry.original}};
+  }
+  json data = {{"game", gameFolder}, {"files", entries}};
+
+  std::filesystem::path tmpPath = file;
+  tmpPath += ".tmp";
+  std::ofstream f(tmpPath);
+  if (!f) {
+    return false;
+  }
+  f << data.dump(2);
+  f.close();
+
+  std::filesystem::rename(tmpPath, file);
+  return true;
+}
+
+void Manifest::clear() {
+  gameFolder.clear();
+  files.clear();
+}
+
+} // namespace BML
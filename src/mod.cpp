@@ -7,32 +7,39 @@ namespace BML {
 Mod::Mod() {}
 Mod::~Mod() {}
 
-Mod::Mod(std::string name) : m_name(name) {}
+Mod::Mod(const std::string &name) : m_name(name) {}
 
-Mod::Mod(std::string name, std::string author)
+Mod::Mod(const std::string &name, const std::string &author)
     : m_name(name), m_author(author) {}
 
-Mod::Mod(std::string name, std::string author, std::string version)
+Mod::Mod(const std::string &name, const std::string &author,
+         const std::string &version)
     : m_name(name), m_author(author) {
   setVersion(version);
 }
 
-std::string Mod::name() { return m_name; }
-std::string Mod::author() { return m_author; }
-std::string Mod::version() { return m_version; }
-std::string Mod::majorVersion() { return m_majorVersion; }
-std::string Mod::minorVersion() { return m_minorVersion; }
-std::string Mod::path() { return m_path; }
-std::string Mod::print() {
+const std::string &Mod::name() const { return m_name; }
+const std::string &Mod::author() const { return m_author; }
+const std::string &Mod::version() const { return m_version; }
+const std::string &Mod::majorVersion() const { return m_majorVersion; }
+const std::string &Mod::minorVersion() const { return m_minorVersion; }
+const std::string &Mod::path() const { return m_path; }
+const Version &Mod::versionNumber() const { return m_versionNumber; }
+const VersionConstraint &Mod::versionConstraint() const {
+  return m_versionConstraint;
+}
+std::string Mod::print() const {
   return (m_name + " | [v" + m_version + "] (" + m_author + ")");
 }
-QString Mod::printQString() { return ("\"" + QString(print().c_str()) + "\""); }
+QString Mod::printQString() const {
+  return ("\"" + QString(print().c_str()) + "\"");
+}
 
-void Mod::setName(std::string name) { m_name = name; }
-void Mod::setAuthor(std::string author) { m_author = author; }
-void Mod::setPath(std::string path) { m_path = path; }
+void Mod::setName(const std::string &name) { m_name = name; }
+void Mod::setAuthor(const std::string &author) { m_author = author; }
+void Mod::setPath(const std::string &path) { m_path = path; }
 
-bool validVersionNumber(std::string str) {
+static bool validVersionNumber(const std::string &str) {
   if (str.empty()) {
     return false;
   }
@@ -51,8 +58,10 @@ bool validVersionNumber(std::string str) {
   return true;
 }
 
-void Mod::setVersion(std::string version) {
+void Mod::setVersion(const std::string &version) {
   m_version = version;
+  m_versionNumber = Version::parse(version);
+  m_versionConstraint = VersionConstraint::parse(version);
 
   size_t delimiterPos = version.find('.');
 
@@ -74,7 +83,7 @@ void Mod::setVersion(std::string version) {
   }
 }
 
-uint8_t Mod::checkValid() {
+uint8_t Mod::checkValid() const {
   if (m_name.empty()) {
     return 1;
   }
@@ -97,12 +106,9 @@ uint8_t Mod::checkValid() {
       return 6;
     }
 
-    // Iterate recursively through the directory
-    for (const auto &entry :
-         std::filesystem::recursive_directory_iterator(m_path)) {
-      if (entry.is_directory() && entry.path().filename() == "Data") {
-        return 0;
-      }
+    // Staging reads from <path>/Data, so that is the only place to look
+    if (std::filesystem::is_directory(std::filesystem::path(m_path) / "Data")) {
+      return 0;
     }
   } catch (const std::filesystem::filesystem_error &e) {
     return 10;
@@ -112,7 +118,23 @@ uint8_t Mod::checkValid() {
   return 12;
 }
 
-bool Mod::compare(Mod mod) {
+uint8_t Mod::checkConstraint() const {
+  if (m_name.empty()) {
+    return 1;
+  }
+  if (m_author.empty()) {
+    return 2;
+  }
+  if (m_version.empty()) {
+    return 3;
+  }
+  if (!m_versionConstraint.valid()) {
+    return 4;
+  }
+  return 0;
+}
+
+bool Mod::compare(const Mod &mod) const {
   if (mod.name() != m_name) {
     return 1;
   }
@@ -0,0 +1,120 @@
+#include "profile.h"
+#include "json.hpp"
+#include "scanner.h"
+#include <QCryptographicHash>
+#include <fstream>
+
+using json = nlohmann::json;
+
+namespace BML {
+
+Profile::Profile() {}
+
+Profile::Profile(std::string name, std::vector<Mod> mods)
+    : name(name), mods(mods) {}
+
+Profile::~Profile() {}
+
+std::filesystem::path Profile::folder() {
+  return std::filesystem::current_path() / "Profiles";
+}
+
+std::filesystem::path Profile::file(const std::string &name) {
+  return folder() / (name + ".json");
+}
+
+bool Profile::load(const std::filesystem::path &file) {
+  name = file.stem().string();
+  mods.clear();
+  savedHash.clear();
+
+  std::ifstream f(file);
+  if (!f.is_open()) {
+    return false;
+  }
+
+  try {
+    // A bare list of identities is accepted too, for profiles written by hand
+    json data = json::parse(f);
+    const json &list = data.is_object() ? data.at("mods") : data;
+    if (data.is_object()) {
+      name = data.value("name", name);
+      savedHash = data.value("hash", "");
+    }
+    for (auto &entry : list) {
+      Mod mod(entry.at("name").get<std::string>(),
+              entry.at("author").get<std::string>(),
+              entry.at("version").get<std::string>());
+      mod.setPath(entry.value("path", ""));
+      mods.push_back(mod);
+    }
+  } catch (const std::exception &e) {
+    mods.clear();
+    return false;
+  }
+  return true;
+}
+
+bool Profile::save(const std::filesystem::path &file) {
+  json list = json::array();
+  for (auto &mod : mods) {
+    list.push_back({{"name", mod.name()},
+                    {"author", mod.author()},
+                    {"version", mod.version()},
+                    {"path", mod.path()}});
+  }
+  savedHash = hash();
+  json data = {{"name", name}, {"hash", savedHash}, {"mods", list}};
+
+  std::filesystem::create_directories(file.parent_path());
+  std::filesystem::path tmpPath = file;
+  tmpPath += ".tmp";
+  std::ofstream f(tmpPath);
+  if (!f) {
+    return false;
+  }
+  f << data.dump(2);
+  f.close();
+
+  std::filesystem::rename(tmpPath, file);
+  return true;
+}
+
+std::string Profile::hash() {
+  // Folders are left out, the same mods in the same order are the same
+  // profile wherever they live
+  QCryptographicHash hasher(QCryptographicHash::Sha1);
+  for (auto &mod : mods) {
+    std::string identity =
+        mod.name() + '\n' + mod.author() + '\n' + mod.version() + '\n';
+    hasher.addData(identity.c_str(), identity.size());
+  }
+  return hasher.result().toHex().toStdString();
+}
+
+std::vector<Mod> Profile::resolve(ScanCache *cache,
+                                  std::vector<Mod> &missing) {
+  std::vector<Mod> resolved;
+  missing.clear();
+
+  for (auto &identity : mods) {
+    Mod mod;
+    bool found = false;
+    if (!identity.path().empty()) {
+      // Only a stat when the folder is in the cache and unchanged
+      ScanResult result = scanModFolder(identity.path(), cache);
+      found = result.valid;
+      mod = result.mod;
+    }
+
+    // The folder may since hold another mod, or another version of it
+    if (!found || mod.compare(identity) != 0 || mod.checkValid() != 0) {
+      missing.push_back(identity);
+      continue;
+    }
+    resolved.push_back(mod);
+  }
+  return resolved;
+}
+
+} // namespace BML
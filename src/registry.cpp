@@ -0,0 +1,71 @@
+#include "registry.h"
+
+namespace BML {
+
+ModRegistry::ModRegistry() {}
+
+ModRegistry::~ModRegistry() {}
+
+std::string ModRegistry::key(const Mod &mod) {
+  return mod.name() + '\n' + mod.author();
+}
+
+ModRegistry::VersionKey ModRegistry::versionKey(const Mod &mod) {
+  return VersionKey(mod.versionNumber().key(), mod.version());
+}
+
+bool ModRegistry::add(const Mod &mod) {
+  auto &bucket = index[key(mod)];
+  if (!bucket.emplace(versionKey(mod), list.size()).second) {
+    return false;
+  }
+  if (!mod.path().empty()) {
+    paths.emplace(mod.path(), list.size());
+  }
+  list.push_back(mod);
+  return true;
+}
+
+void ModRegistry::clear() {
+  list.clear();
+  index.clear();
+  paths.clear();
+}
+
+size_t ModRegistry::size() const { return list.size(); }
+
+const std::vector<Mod> &ModRegistry::mods() const { return list; }
+
+const Mod *ModRegistry::find(const Mod &identity) const {
+  auto bucket = index.find(key(identity));
+  if (bucket == index.end()) {
+    return nullptr;
+  }
+  auto version = bucket->second.find(versionKey(identity));
+  if (version == bucket->second.end()) {
+    return nullptr;
+  }
+  return &list[version->second];
+}
+
+const Mod *ModRegistry::findPath(const std::string &path) const {
+  auto it = paths.find(path);
+  if (it == paths.end()) {
+    return nullptr;
+  }
+  return &list[it->second];
+}
+
+std::vector<const Mod *> ModRegistry::versions(const Mod &identity) const {
+  std::vector<const Mod *> found;
+  auto bucket = index.find(key(identity));
+  if (bucket == index.end()) {
+    return found;
+  }
+  for (auto &[version, position] : bucket->second) {
+    found.push_back(&list[position]);
+  }
+  return found;
+}
+
+} // namespace BML
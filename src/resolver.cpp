@@ -0,0 +1,496 @@
+#include "resolver.h"
+#include "registry.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace BML {
+
+bool sortLoadOrder(const std::vector<Mod> &mods, std::vector<Mod> &sorted,
+                   std::vector<Mod> &duplicates, std::vector<Mod> &cycle) {
+  sorted.clear();
+  duplicates.clear();
+  cycle.clear();
+
+  ModRegistry index;
+  for (auto &mod : mods) {
+    if (!index.add(mod)) {
+      duplicates.push_back(mod);
+    }
+  }
+  const std::vector<Mod> &list = index.mods();
+  std::unordered_map<const Mod *, size_t> positions;
+  for (size_t i = 0; i < list.size(); i++) {
+    positions[&list[i]] = i;
+  }
+
+  // Depth first, emitting a mod once everything it depends on is emitted.
+  // Each mod and dependency is visited once.
+  enum State : uint8_t { Unvisited, Visiting, Done };
+  std::vector<State> states(list.size(), Unvisited);
+  std::vector<size_t> path;
+
+  std::function<bool(size_t)> visit = [&](size_t i) {
+    states[i] = Visiting;
+    path.push_back(i);
+
+    for (auto &dep : list[i].dependencies) {
+      for (auto candidate : index.versions(dep)) {
+        if (!dep.versionConstraint().matches(candidate->versionNumber())) {
+          continue;
+        }
+
+        size_t j = positions[candidate];
+        if (states[j] == Visiting) {
+          // Everything on the path from j back to here is part of the loop
+          for (size_t k = path.size(); k-- > 0;) {
+            cycle.insert(cycle.begin(), list[path[k]]);
+            if (path[k] == j) {
+              break;
+            }
+          }
+          return false;
+        }
+        if (states[j] == Unvisited && !visit(j)) {
+          return false;
+        }
+        break;
+      }
+    }
+
+    path.pop_back();
+    states[i] = Done;
+    sorted.push_back(list[i]);
+    return true;
+  };
+
+  for (size_t i = 0; i < list.size(); i++) {
+    if (states[i] == Unvisited && !visit(i)) {
+      sorted.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+namespace {
+
+// The mods reachable from the requests, with names and authors replaced by
+// numbers so the search never compares a string
+struct Graph {
+  struct Edge {
+    size_t target;
+    const VersionConstraint *constraint;
+  };
+  // One available version of a mod
+  struct Node {
+    size_t key;
+    Version version;
+    const Mod *mod;
+    std::vector<Edge> dependencies;
+    std::vector<Edge> incompatibilities;
+  };
+
+  Graph(const std::vector<Mod> &mods, const ModRegistry &available);
+
+  std::vector<Node> nodes;
+  // Nodes of each mod, newest first
+  std::vector<std::vector<size_t>> versions;
+  std::vector<Edge> requests;
+};
+
+Graph::Graph(const std::vector<Mod> &mods, const ModRegistry &available) {
+  std::unordered_map<std::string, size_t> keys;
+  std::vector<const Mod *> identities;
+  auto keyOf = [&](const Mod &mod) {
+    auto [it, added] =
+        keys.emplace(mod.name() + '\n' + mod.author(), identities.size());
+    if (added) {
+      identities.push_back(&mod);
+      versions.emplace_back();
+    }
+    return it->second;
+  };
+
+  for (auto &mod : mods) {
+    requests.push_back(Edge{keyOf(mod), &mod.versionConstraint()});
+  }
+
+  // Only mods something depends on are ever picked, the others only need a
+  // number for incompatibilities to point at
+  std::vector<bool> expanded;
+  std::vector<size_t> queue;
+  for (auto &request : requests) {
+    queue.push_back(request.target);
+  }
+  while (!queue.empty()) {
+    size_t key = queue.back();
+    queue.pop_back();
+    expanded.resize(identities.size(), false);
+    if (expanded[key]) {
+      continue;
+    }
+    expanded[key] = true;
+
+    std::vector<const Mod *> found = available.versions(*identities[key]);
+    // The registry lists versions oldest first
+    for (auto it = found.rbegin(); it != found.rend(); ++it) {
+      const Mod *mod = *it;
+      Node node{key, mod->versionNumber(), mod, {}, {}};
+      for (auto &dep : mod->dependencies) {
+        node.dependencies.push_back(Edge{keyOf(dep), &dep.versionConstraint()});
+        queue.push_back(node.dependencies.back().target);
+      }
+      for (auto &incompatible : mod->incompatibilities) {
+        node.incompatibilities.push_back(
+            Edge{keyOf(incompatible), &incompatible.versionConstraint()});
+      }
+      versions[key].push_back(nodes.size());
+      nodes.push_back(std::move(node));
+    }
+  }
+}
+
+// Backtracking search for one version of each mod. A branch that fails
+// reports the picks that caused it, so the search jumps straight back over
+// picks that played no part. Those picks are remembered as a combination that
+// cannot work, so no other branch goes down the same path again.
+class Solver {
+
+public:
+  Solver(const Graph &graph, std::chrono::steady_clock::time_point deadline);
+
+  // Nodes in the order they were picked. Requests are given by position in
+  // the graph's requests.
+  bool solve(const std::vector<size_t> &requests, std::vector<size_t> &picks);
+
+  bool timedOut;
+
+private:
+  static constexpr size_t none = SIZE_MAX;
+
+  // A constraint on a mod and the depth of the pick it came from, 0 for the
+  // requests
+  struct Entry {
+    const VersionConstraint *constraint;
+    size_t depth;
+  };
+  // Depths of the picks to blame for a failure, one bit each
+  using Blame = std::vector<uint64_t>;
+
+  void blame(Blame &set, size_t depth) {
+    set[depth / 64] |= uint64_t(1) << (depth % 64);
+  }
+  bool blamed(const Blame &set, size_t depth) {
+    return set[depth / 64] >> (depth % 64) & 1;
+  }
+
+  const std::vector<Graph::Edge> &requirements(size_t owner);
+  bool compatible(size_t key, size_t node, Blame &reasons);
+  void pick(size_t node);
+  void unpick();
+  void learn(const Blame &reasons);
+  bool search(size_t owner, size_t entry);
+
+  const Graph &graph;
+  std::chrono::steady_clock::time_point deadline;
+  size_t visited;
+
+  std::vector<Graph::Edge> requests;
+  std::vector<size_t> order;
+  std::vector<size_t> picked;
+  std::vector<size_t> depthOf;
+  std::vector<std::vector<Entry>> demands;
+  std::vector<std::vector<Entry>> forbids;
+  // One per depth, filled by a failing search for its caller to read
+  std::vector<Blame> failures;
+
+  // Failed combinations of picks, found through each of their nodes
+  std::vector<std::vector<size_t>> nogoods;
+  std::vector<std::vector<size_t>> nogoodsOf;
+};
+
+Solver::Solver(const Graph &graph,
+               std::chrono::steady_clock::time_point deadline)
+    : timedOut(false), graph(graph), deadline(deadline), visited(0),
+      picked(graph.versions.size(), none), depthOf(graph.versions.size(), 0),
+      demands(graph.versions.size()), forbids(graph.versions.size()),
+      failures(graph.versions.size() + 2,
+               Blame((graph.versions.size() + 1) / 64 + 1)),
+      nogoodsOf(graph.nodes.size()) {}
+
+const std::vector<Graph::Edge> &Solver::requirements(size_t owner) {
+  return owner == 0 ? requests : graph.nodes[order[owner - 1]].dependencies;
+}
+
+bool Solver::compatible(size_t key, size_t node, Blame &reasons) {
+  const Graph::Node &candidate = graph.nodes[node];
+  bool ok = true;
+
+  for (auto &demand : demands[key]) {
+    if (!demand.constraint->matches(candidate.version)) {
+      ok = false;
+      blame(reasons, demand.depth);
+    }
+  }
+  for (auto &forbid : forbids[key]) {
+    if (forbid.constraint->matches(candidate.version)) {
+      ok = false;
+      blame(reasons, forbid.depth);
+    }
+  }
+
+  for (auto &incompatible : candidate.incompatibilities) {
+    size_t other = picked[incompatible.target];
+    if (other != none &&
+        incompatible.constraint->matches(graph.nodes[other].version)) {
+      ok = false;
+      blame(reasons, depthOf[incompatible.target]);
+    }
+  }
+  for (auto &dep : candidate.dependencies) {
+    if (dep.target == key) {
+      ok &= dep.constraint->matches(candidate.version);
+      continue;
+    }
+    size_t other = picked[dep.target];
+    if (other != none && !dep.constraint->matches(graph.nodes[other].version)) {
+      ok = false;
+      blame(reasons, depthOf[dep.target]);
+    }
+  }
+  if (!ok) {
+    return false;
+  }
+
+  for (size_t id : nogoodsOf[node]) {
+    auto &nogood = nogoods[id];
+    if (std::all_of(nogood.begin(), nogood.end(), [&](size_t member) {
+          return member == node || picked[graph.nodes[member].key] == member;
+        })) {
+      for (size_t member : nogood) {
+        if (member != node) {
+          blame(reasons, depthOf[graph.nodes[member].key]);
+        }
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+void Solver::pick(size_t node) {
+  const Graph::Node &mod = graph.nodes[node];
+  order.push_back(node);
+  size_t depth = order.size();
+  picked[mod.key] = node;
+  depthOf[mod.key] = depth;
+  for (auto &dep : mod.dependencies) {
+    demands[dep.target].push_back(Entry{dep.constraint, depth});
+  }
+  for (auto &incompatible : mod.incompatibilities) {
+    forbids[incompatible.target].push_back(
+        Entry{incompatible.constraint, depth});
+  }
+}
+
+void Solver::unpick() {
+  const Graph::Node &mod = graph.nodes[order.back()];
+  order.pop_back();
+  picked[mod.key] = none;
+  for (auto &dep : mod.dependencies) {
+    demands[dep.target].pop_back();
+  }
+  for (auto &incompatible : mod.incompatibilities) {
+    forbids[incompatible.target].pop_back();
+  }
+}
+
+void Solver::learn(const Blame &reasons) {
+  // Deepest first, the picks most likely to have been undone since are
+  // checked first
+  std::vector<size_t> nogood;
+  for (size_t depth = order.size(); depth > 0; depth--) {
+    if (blamed(reasons, depth)) {
+      nogood.push_back(order[depth - 1]);
+    }
+  }
+  if (nogood.empty()) {
+    return;
+  }
+  for (size_t member : nogood) {
+    nogoodsOf[member].push_back(nogoods.size());
+  }
+  nogoods.push_back(std::move(nogood));
+}
+
+bool Solver::search(size_t owner, size_t entry) {
+  if ((++visited & 255) == 0 && std::chrono::steady_clock::now() > deadline) {
+    timedOut = true;
+  }
+  if (timedOut) {
+    return false;
+  }
+
+  size_t depth = order.size() + 1;
+  Blame &reasons = failures[depth];
+
+  // A requirement of the last pick that one version at most can meet goes
+  // first, so a dead end shows up right next to the pick that caused it
+  const Graph::Edge *dep = nullptr;
+  if (!order.empty()) {
+    for (auto &edge : graph.nodes[order.back()].dependencies) {
+      if (picked[edge.target] != none) {
+        continue;
+      }
+      size_t fits = 0;
+      for (size_t node : graph.versions[edge.target]) {
+        if (compatible(edge.target, node, reasons) && ++fits > 1) {
+          break;
+        }
+      }
+      if (fits <= 1) {
+        dep = &edge;
+        break;
+      }
+    }
+  }
+
+  // Everything before owner and entry is already met by a pick
+  for (; !dep && owner <= order.size(); owner++, entry = 0) {
+    auto &deps = requirements(owner);
+    for (; entry < deps.size(); entry++) {
+      if (picked[deps[entry].target] == none) {
+        dep = &deps[entry];
+        break;
+      }
+    }
+    if (dep) {
+      break;
+    }
+  }
+  if (!dep) {
+    return true;
+  }
+
+  size_t key = dep->target;
+  std::fill(reasons.begin(), reasons.end(), 0);
+
+  for (size_t node : graph.versions[key]) {
+    if (!compatible(key, node, reasons)) {
+      continue;
+    }
+
+    pick(node);
+    if (search(owner, entry)) {
+      return true;
+    }
+    unpick();
+    if (timedOut) {
+      return false;
+    }
+
+    Blame &below = failures[depth + 1];
+    if (!blamed(below, depth)) {
+      // This pick played no part, another version of it cannot help
+      reasons = below;
+      return false;
+    }
+    for (size_t i = 0; i < reasons.size(); i++) {
+      reasons[i] |= below[i];
+    }
+    reasons[depth / 64] &= ~(uint64_t(1) << (depth % 64));
+  }
+
+  // Whatever asked for the mod is to blame as well
+  for (auto &demand : demands[key]) {
+    blame(reasons, demand.depth);
+  }
+  learn(reasons);
+  return false;
+}
+
+bool Solver::solve(const std::vector<size_t> &positions,
+                   std::vector<size_t> &picks) {
+  while (!order.empty()) {
+    unpick();
+  }
+  for (auto &demand : demands) {
+    demand.clear();
+  }
+  // What failed may have depended on requests that are gone now
+  nogoods.clear();
+  for (auto &ids : nogoodsOf) {
+    ids.clear();
+  }
+
+  requests.clear();
+  for (size_t position : positions) {
+    requests.push_back(graph.requests[position]);
+    demands[requests.back().target].push_back(
+        Entry{requests.back().constraint, 0});
+  }
+
+  if (!search(0, 0)) {
+    return false;
+  }
+  picks = order;
+  return true;
+}
+
+} // namespace
+
+Resolution resolveVersions(const std::vector<Mod> &requests,
+                           const ModRegistry &available,
+                           std::chrono::milliseconds budget) {
+  Resolution resolution;
+  Graph graph(requests, available);
+  Solver solver(graph, std::chrono::steady_clock::now() + budget);
+
+  std::vector<size_t> needed;
+  for (size_t i = 0; i < requests.size(); i++) {
+    needed.push_back(i);
+  }
+
+  std::vector<size_t> picks;
+  if (solver.solve(needed, picks)) {
+    // Requests in the order they were given, then the mods they pulled in
+    std::vector<size_t> pickOf(graph.versions.size(), SIZE_MAX);
+    for (size_t node : picks) {
+      pickOf[graph.nodes[node].key] = node;
+    }
+    for (auto &request : graph.requests) {
+      size_t &node = pickOf[request.target];
+      if (node != SIZE_MAX) {
+        resolution.mods.push_back(*graph.nodes[node].mod);
+        node = SIZE_MAX;
+      }
+    }
+    for (size_t node : picks) {
+      if (pickOf[graph.nodes[node].key] == node) {
+        resolution.mods.push_back(*graph.nodes[node].mod);
+      }
+    }
+    resolution.solved = true;
+    return resolution;
+  }
+
+  // Leave out each request in turn and keep it out if the rest still fails.
+  // What is left conflicts without any one request it could lose.
+  for (size_t i = needed.size(); i-- > 0 && !solver.timedOut;) {
+    std::vector<size_t> without = needed;
+    without.erase(without.begin() + i);
+    if (!solver.solve(without, picks) && !solver.timedOut) {
+      needed = std::move(without);
+    }
+  }
+
+  resolution.timedOut = solver.timedOut;
+  for (size_t i : needed) {
+    resolution.conflict.push_back(requests[i]);
+  }
+  return resolution;
+}
+
+} // namespace BML
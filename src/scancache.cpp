@@ -0,0 +1,144 @@
+#include "scancache.h"
+#include "json.hpp"
+#include <fstream>
+
+using json = nlohmann::json;
+
+namespace BML {
+
+static json modToJson(const Mod &mod) {
+  json data = {{"name", mod.name()},
+               {"author", mod.author()},
+               {"version", mod.version()},
+               {"path", mod.path()},
+               {"dependencies", json::array()},
+               {"incompatibilities", json::array()}};
+  for (auto &dep : mod.dependencies) {
+    data["dependencies"].push_back(modToJson(dep));
+  }
+  for (auto &incompat : mod.incompatibilities) {
+    data["incompatibilities"].push_back(modToJson(incompat));
+  }
+  return data;
+}
+
+static Mod modFromJson(const json &data) {
+  Mod mod(data.at("name").get<std::string>(),
+          data.at("author").get<std::string>(),
+          data.at("version").get<std::string>());
+  mod.setPath(data.at("path").get<std::string>());
+  for (auto &dep : data.at("dependencies")) {
+    mod.dependencies.push_back(modFromJson(dep));
+  }
+  for (auto &incompat : data.at("incompatibilities")) {
+    mod.incompatibilities.push_back(modFromJson(incompat));
+  }
+  return mod;
+}
+
+ScanCache::ScanCache(std::filesystem::path file) : file(file) {}
+
+ScanCache::~ScanCache() {}
+
+bool ScanCache::load() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+
+  std::ifstream f(file);
+  if (!f.is_open()) {
+    return false;
+  }
+
+  try {
+    json data = json::parse(f);
+    for (auto &[folder, entry] : data.items()) {
+      entries[folder] = Entry{entry.at("size").get<uintmax_t>(),
+                              entry.at("mtime").get<int64_t>(),
+                              modFromJson(entry.at("mod")), false};
+    }
+  } catch (const std::exception &e) {
+    // A damaged cache only costs a full rescan
+    entries.clear();
+    return false;
+  }
+  return true;
+}
+
+bool ScanCache::save() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // Mods not looked up since the last load are kept while their bml.json is
+  // unchanged, so a run that only reads part of the cache does not empty it
+  // and removed mods still drop out
+  json data = json::object();
+  for (auto &[folder, entry] : entries) {
+    uintmax_t size;
+    int64_t mtime;
+    if (!entry.used && (!stat(folder, size, mtime) || size != entry.size ||
+                        mtime != entry.mtime)) {
+      continue;
+    }
+    data[folder] = {{"size", entry.size},
+                    {"mtime", entry.mtime},
+                    {"mod", modToJson(entry.mod)}};
+  }
+
+  std::filesystem::create_directories(file.parent_path());
+  std::filesystem::path tmpPath = file;
+  tmpPath += ".tmp";
+  std::ofstream f(tmpPath);
+  if (!f) {
+    return false;
+  }
+  f << data.dump();
+  f.close();
+
+  std::filesystem::rename(tmpPath, file);
+  return true;
+}
+
+bool ScanCache::find(const std::filesystem::path &folder, Mod &mod) {
+  uintmax_t size;
+  int64_t mtime;
+  if (!stat(folder, size, mtime)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(folder.string());
+  if (it == entries.end() || size != it->second.size ||
+      mtime != it->second.mtime) {
+    return false;
+  }
+
+  it->second.used = true;
+  mod = it->second.mod;
+  return true;
+}
+
+void ScanCache::insert(const std::filesystem::path &folder, const Mod &mod) {
+  uintmax_t size;
+  int64_t mtime;
+  if (!stat(folder, size, mtime)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  entries[folder.string()] = Entry{size, mtime, mod, true};
+}
+
+bool ScanCache::stat(const std::filesystem::path &folder, uintmax_t &size,
+                     int64_t &mtime) {
+  std::error_code ec;
+  std::filesystem::path modFile = folder / "bml.json";
+  size = std::filesystem::file_size(modFile, ec);
+  if (ec) {
+    return false;
+  }
+  mtime = std::filesystem::last_write_time(modFile, ec)
+              .time_since_epoch()
+              .count();
+  return !ec;
+}
+
+} // namespace BML
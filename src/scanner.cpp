@@ -0,0 +1,195 @@
+#include "scanner.h"
+#include "json.hpp"
+#include "threadpool.h"
+#include <algorithm>
+#include <fstream>
+
+using json = nlohmann::json;
+
+namespace BML {
+
+static bool parseModFile(const std::filesystem::path &folder, Mod &mod,
+                         std::vector<QString> &messages) {
+  std::ifstream f(folder / "bml.json");
+  if (!f.is_open()) {
+    messages.push_back("-- !! Failed to open bml.json !!");
+    return false;
+  }
+
+  json data;
+  try {
+    data = json::parse(f);
+    f.close();
+  } catch (const json::parse_error &e) {
+    messages.push_back("-- !! Failed to parse bml.json !! [" +
+                       QString(e.what()) + "]");
+    return false;
+  } catch (const std::exception &e) {
+    messages.push_back("-- !! Failed to parse bml.json !! [" +
+                       QString(e.what()) + "]");
+    return false;
+  }
+
+  if (data.contains("name") &&
+      data.find("name")->type() == json::value_t::string) {
+    mod.setName(data.find("name").value());
+  } else {
+    messages.push_back("-- !! No valid name in bml.json !!");
+  }
+
+  if (data.contains("author") &&
+      data.find("author")->type() == json::value_t::string) {
+    mod.setAuthor(data.find("author").value());
+  } else {
+    messages.push_back("-- !! No valid author in bml.json !!");
+  }
+
+  if (data.contains("version") &&
+      data.find("version")->type() == json::value_t::string) {
+    mod.setVersion(data.find("version").value());
+  } else {
+    messages.push_back("-- !! No valid version in bml.json !!");
+  }
+
+  mod.setPath(folder.string());
+
+  if (data.contains("dependencies") &&
+      data.find("dependencies")->type() == json::value_t::array) {
+    messages.push_back("-- Adding dependencies");
+
+    for (auto &dep : data.find("dependencies").value()) {
+      Mod depend = Mod();
+
+      if (dep.contains("name") &&
+          dep.find("name")->type() == json::value_t::string) {
+        depend.setName(dep.find("name").value());
+      } else {
+        messages.push_back("--- ! Dependency with no valid name !");
+      }
+
+      if (dep.contains("author") &&
+          dep.find("author")->type() == json::value_t::string) {
+        depend.setAuthor(dep.find("author").value());
+      } else {
+        messages.push_back("--- ! Dependency with no valid author !");
+      }
+
+      if (dep.contains("version") &&
+          dep.find("version")->type() == json::value_t::string) {
+        depend.setVersion(dep.find("version").value());
+      } else {
+        messages.push_back("--- ! Dependency with no valid version !");
+      }
+
+      if (depend.checkConstraint() == 0) {
+        messages.push_back("--- Dependency added: " + depend.printQString());
+        mod.dependencies.push_back(depend);
+      } else {
+        messages.push_back("-- !! Broken bml.json dependencies detected "
+                           "!! Ignoring mod in folder \"" +
+                           QString(folder.filename().c_str()) + "\" !!");
+        return false;
+      }
+    }
+  }
+
+  if (data.contains("incompatibilities") &&
+      data.find("incompatibilities")->type() == json::value_t::array) {
+    messages.push_back("-- Adding incompatibilities");
+
+    for (auto &incompatible : data.find("incompatibilities").value()) {
+      Mod incompat = Mod();
+
+      if (incompatible.contains("name") &&
+          incompatible.find("name")->type() == json::value_t::string) {
+        incompat.setName(incompatible.find("name").value());
+      } else {
+        messages.push_back("--- ! Incompatibility with no valid name !");
+      }
+
+      if (incompatible.contains("author") &&
+          incompatible.find("author")->type() == json::value_t::string) {
+        incompat.setAuthor(incompatible.find("author").value());
+      } else {
+        messages.push_back("--- ! Incompatibility with no valid author !");
+      }
+
+      if (incompatible.contains("version") &&
+          incompatible.find("version")->type() == json::value_t::string) {
+        incompat.setVersion(incompatible.find("version").value());
+      } else {
+        messages.push_back("--- ! Incompatibility with no valid version !");
+      }
+
+      if (incompat.checkConstraint() == 0) {
+        messages.push_back("--- Incompatibility added: " +
+                           incompat.printQString());
+        mod.incompatibilities.push_back(incompat);
+      } else {
+        messages.push_back("-- !! Broken bml.json incompatibilities detected "
+                           "!! Ignoring mod in folder \"" +
+                           QString(folder.filename().c_str()) + "\" !!");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+ScanResult scanModFolder(const std::filesystem::path &folder,
+                         ScanCache *cache) {
+  ScanResult result;
+  try {
+    if (!std::filesystem::is_regular_file(folder / "bml.json")) {
+      return result;
+    }
+    result.found = true;
+
+    result.messages.push_back("\n- Found mod in folder: " +
+                              QString(folder.filename().c_str()));
+
+    if (cache->find(folder, result.mod)) {
+      // bml.json is unchanged since it was last parsed
+      result.messages.push_back("-- Loaded " + result.mod.printQString() +
+                                " from scan cache");
+      result.valid = true;
+      return result;
+    }
+
+    // Never cache a broken mod, so its errors are reported on every scan
+    result.valid = parseModFile(folder, result.mod, result.messages);
+    if (result.valid) {
+      cache->insert(folder, result.mod);
+    }
+  } catch (const std::exception &e) {
+    result.messages.push_back("-- !! Failed to read mod folder !! [" +
+                              QString(e.what()) + "]");
+    result.valid = false;
+  }
+  return result;
+}
+
+std::vector<ScanResult> scanModsFolder(const std::filesystem::path &modsFolder,
+                                       ScanCache *cache) {
+  std::vector<std::filesystem::path> folders;
+  for (const auto &entry : std::filesystem::directory_iterator(modsFolder)) {
+    if (entry.is_directory()) {
+      folders.push_back(entry.path());
+    }
+  }
+  std::sort(folders.begin(), folders.end());
+
+  // Every task owns one slot, so results need no locking
+  std::vector<ScanResult> results(folders.size());
+  ThreadPool pool;
+  for (size_t i = 0; i < folders.size(); i++) {
+    pool.submit([&results, &folders, cache, i]() {
+      results[i] = scanModFolder(folders[i], cache);
+    });
+  }
+  pool.wait();
+
+  return results;
+}
+
+} // namespace BML
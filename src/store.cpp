@@ -0,0 +1,176 @@
+#include "store.h"
+#include "fileops.h"
+#include "json.hpp"
+#include <QCryptographicHash>
+#include <QFile>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace BML {
+
+// SHA-1 of the content of file as hex, empty if it cannot be read
+static std::string sha1(const std::filesystem::path &file) {
+  QFile f(QString(file.c_str()));
+  if (!f.open(QIODevice::ReadOnly)) {
+    return std::string();
+  }
+
+  QCryptographicHash hasher(QCryptographicHash::Sha1);
+  if (!hasher.addData(&f)) {
+    return std::string();
+  }
+  f.close();
+  return hasher.result().toHex().toStdString();
+}
+
+ObjectStore::ObjectStore(std::filesystem::path root) : root(root) {}
+
+ObjectStore::~ObjectStore() {}
+
+bool ObjectStore::load() {
+  std::lock_guard<std::mutex> lock(mutex);
+  index.clear();
+
+  std::ifstream f(root / "index.json");
+  if (!f.is_open()) {
+    return false;
+  }
+
+  try {
+    json data = json::parse(f);
+    for (auto &[source, entry] : data.items()) {
+      index[source] = IndexEntry{entry.at("size").get<uintmax_t>(),
+                                 entry.at("mtime").get<int64_t>(),
+                                 entry.at("hash").get<std::string>()};
+    }
+  } catch (const std::exception &e) {
+    // A damaged index only costs a rehash, so start from scratch
+    index.clear();
+    return false;
+  }
+  return true;
+}
+
+bool ObjectStore::save() {
+  std::lock_guard<std::mutex> lock(mutex);
+  json data = json::object();
+  for (auto &[source, entry] : index) {
+    data[source] = {
+        {"size", entry.size}, {"mtime", entry.mtime}, {"hash", entry.hash}};
+  }
+
+  std::filesystem::create_directories(root);
+  std::filesystem::path tmpPath = root / "index.json.tmp";
+  std::ofstream f(tmpPath);
+  if (!f) {
+    return false;
+  }
+  f << data.dump();
+  f.close();
+
+  std::filesystem::rename(tmpPath, root / "index.json");
+  return true;
+}
+
+std::string ObjectStore::hashFile(const std::filesystem::path &file) {
+  uintmax_t size = std::filesystem::file_size(file);
+  int64_t mtime =
+      std::filesystem::last_write_time(file).time_since_epoch().count();
+
+  // Reuse the previous hash if the source has not been touched since
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(file.string());
+    if (it != index.end() && it->second.size == size &&
+        it->second.mtime == mtime) {
+      return it->second.hash;
+    }
+  }
+
+  std::string hash = sha1(file);
+  if (hash.empty()) {
+    return hash;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  index[file.string()] = IndexEntry{size, mtime, hash};
+  return hash;
+}
+
+std::string ObjectStore::store(const std::filesystem::path &file) {
+  std::string hash = hashFile(file);
+  if (hash.empty()) {
+    return hash;
+  }
+
+  // Objects are only ever written here, complete and never linked to a
+  // file outside the store, so one that exists is trusted
+  std::filesystem::path object = objectPath(hash);
+  if (std::filesystem::exists(object)) {
+    return hash;
+  }
+
+  // Reflink to a temporary name first so an interrupted clone never leaves a
+  // truncated object behind under a valid hash. The name is per thread since
+  // two files with the same content may be stored at the same time.
+  std::filesystem::create_directories(object.parent_path());
+  std::filesystem::path tmpPath = object;
+  tmpPath += ".tmp" + std::to_string(std::hash<std::thread::id>{}(
+                          std::this_thread::get_id()));
+  std::filesystem::remove(tmpPath);
+  if (reflinkFile(file, tmpPath)) {
+    std::filesystem::rename(tmpPath, object);
+  }
+  return hash;
+}
+
+std::string ObjectStore::stage(const std::filesystem::path &file,
+                               const std::filesystem::path &dest) {
+  std::string hash = store(file);
+  if (hash.empty()) {
+    return hash;
+  }
+
+  // From the object if there is one, the mod file otherwise
+  std::filesystem::path object = objectPath(hash);
+  cloneFile(std::filesystem::exists(object) ? object : file, dest, false);
+  return hash;
+}
+
+std::filesystem::path ObjectStore::objectPath(const std::string &hash) {
+  return root / "objects" / hash.substr(0, 2) / hash;
+}
+
+size_t ObjectStore::prune(const std::set<std::string> &keep) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = index.begin(); it != index.end();) {
+    if (keep.count(it->second.hash)) {
+      ++it;
+    } else {
+      it = index.erase(it);
+    }
+  }
+
+  std::filesystem::path objects = root / "objects";
+  if (!std::filesystem::is_directory(objects)) {
+    return 0;
+  }
+
+  // Collected first, removing while iterating is not allowed. Leftover
+  // temporary copies have no valid hash as a name and go as well.
+  std::vector<std::filesystem::path> unused;
+  for (auto &entry : std::filesystem::recursive_directory_iterator(objects)) {
+    if (entry.is_regular_file() &&
+        !keep.count(entry.path().filename().string())) {
+      unused.push_back(entry.path());
+    }
+  }
+  for (auto &path : unused) {
+    std::filesystem::remove(path);
+  }
+  return unused.size();
+}
+
+} // namespace BML
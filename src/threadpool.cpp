@@ -0,0 +1,76 @@
+#include "threadpool.h"
+#include <algorithm>
+
+namespace BML {
+
+ThreadPool::ThreadPool(size_t threads) : running(0), stopping(false) {
+  if (threads == 0) {
+    // File copies mostly wait on the disk, so allow some more threads than
+    // cores to keep the device queue full
+    threads =
+        std::clamp<size_t>(std::thread::hardware_concurrency() * 2, 2, 16);
+  }
+  maxQueued = threads * 4;
+
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  taskQueued.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  std::unique_lock<std::mutex> lock(mutex);
+  taskTaken.wait(lock, [this] { return tasks.size() < maxQueued; });
+  tasks.push_back(std::move(task));
+  taskQueued.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  tasksDone.wait(lock, [this] { return tasks.empty() && running == 0; });
+}
+
+size_t ThreadPool::size() const { return workers.size(); }
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      taskQueued.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+      running++;
+    }
+    taskTaken.notify_one();
+
+    try {
+      task();
+    } catch (...) {
+      // Tasks report their own errors, never let one take down the worker
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      running--;
+      if (tasks.empty() && running == 0) {
+        tasksDone.notify_all();
+      }
+    }
+  }
+}
+
+} // namespace BML
@@ -0,0 +1,106 @@
+#include "validator.h"
+
+namespace BML {
+
+ListValidator::ListValidator() {}
+
+ListValidator::~ListValidator() {}
+
+std::string ListValidator::key(const Mod &mod) {
+  return mod.name() + '\n' + mod.author();
+}
+
+std::vector<std::string> ListValidator::add(const Mod &mod) {
+  std::vector<std::string> changed;
+  if (!mods.emplace(mod.path(), mod).second) {
+    return changed;
+  }
+
+  listed[key(mod)].insert(mod.path());
+  for (auto &dep : mod.dependencies) {
+    watchers[key(dep)].insert(mod.path());
+  }
+  for (auto &incompatible : mod.incompatibilities) {
+    watchers[key(incompatible)].insert(mod.path());
+  }
+
+  changed.push_back(mod.path());
+  for (auto &path : watchers[key(mod)]) {
+    if (path != mod.path()) {
+      changed.push_back(path);
+    }
+  }
+  for (auto &path : changed) {
+    check(path);
+  }
+  return changed;
+}
+
+std::vector<std::string> ListValidator::remove(const std::string &path) {
+  std::vector<std::string> changed;
+  auto it = mods.find(path);
+  if (it == mods.end()) {
+    return changed;
+  }
+  Mod mod = it->second;
+  mods.erase(it);
+  found.erase(path);
+
+  listed[key(mod)].erase(path);
+  for (auto &dep : mod.dependencies) {
+    watchers[key(dep)].erase(path);
+  }
+  for (auto &incompatible : mod.incompatibilities) {
+    watchers[key(incompatible)].erase(path);
+  }
+
+  for (auto &watcher : watchers[key(mod)]) {
+    changed.push_back(watcher);
+    check(watcher);
+  }
+  return changed;
+}
+
+void ListValidator::clear() {
+  mods.clear();
+  listed.clear();
+  watchers.clear();
+  found.clear();
+}
+
+const std::vector<std::string> &ListValidator::problems(
+    const std::string &path) {
+  return found[path];
+}
+
+void ListValidator::check(const std::string &path) {
+  const Mod &mod = mods.at(path);
+  std::vector<std::string> &problems = found[path];
+  problems.clear();
+
+  // Same rules as dependCheck and incompatibleCheck, over the whole list
+  for (auto &dep : mod.dependencies) {
+    bool met = false;
+    for (auto &other : listed[key(dep)]) {
+      if (dep.versionConstraint().matches(mods.at(other).versionNumber())) {
+        met = true;
+        break;
+      }
+    }
+    if (!met) {
+      problems.push_back("Missing dependency " + dep.print());
+    }
+  }
+
+  for (auto &incompatible : mod.incompatibilities) {
+    for (auto &other : listed[key(incompatible)]) {
+      const Mod &clash = mods.at(other);
+      if (incompatible.versionConstraint().matches(clash.versionNumber())) {
+        problems.push_back("Incompatible with " + clash.print());
+        break;
+      }
+    }
+  }
+}
+
+} // namespace BML
@@ -0,0 +1,131 @@
+#include "version.h"
+#include <algorithm>
+#include <limits>
+
+namespace BML {
+
+static const uint32_t anyPart = std::numeric_limits<uint32_t>::max();
+
+// Digits only, or X for a wildcard when allowed
+static bool parsePart(const std::string &text, bool allowWildcard,
+                      uint32_t &part) {
+  if (allowWildcard && (text == "X" || text == "x" || text == "*")) {
+    part = anyPart;
+    return true;
+  }
+  if (text.empty() || text.size() > 9) {
+    return false;
+  }
+  for (char c : text) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+  }
+  part = std::stoul(text);
+  return true;
+}
+
+static bool parsePattern(const std::string &text, bool allowWildcard,
+                         uint32_t &major, uint32_t &minor) {
+  size_t delimiterPos = text.find('.');
+  if (delimiterPos == std::string::npos) {
+    minor = anyPart;
+    return allowWildcard && parsePart(text, true, major);
+  }
+  return parsePart(text.substr(0, delimiterPos), allowWildcard, major) &&
+         parsePart(text.substr(delimiterPos + 1), allowWildcard, minor);
+}
+
+Version Version::parse(const std::string &text) {
+  Version version;
+  version.valid = parsePattern(text, false, version.major, version.minor);
+  return version;
+}
+
+VersionConstraint::VersionConstraint()
+    : m_valid(false), lowest(1), highest(0), fixedMinor(false), minor(0) {}
+
+VersionConstraint VersionConstraint::parse(const std::string &text) {
+  VersionConstraint constraint;
+  constraint.lowest = 0;
+  constraint.highest = std::numeric_limits<uint64_t>::max();
+
+  std::string token;
+  std::string op;
+  bool any = false;
+  for (size_t i = 0; i <= text.size(); i++) {
+    if (i < text.size() && text[i] != ' ' && text[i] != ',') {
+      token += text[i];
+      continue;
+    }
+    if (token.empty()) {
+      continue;
+    }
+
+    // An operator may be separated from its version, as in ">= 1.2"
+    size_t opLength = token.find_first_not_of("<>=");
+    if (opLength == std::string::npos) {
+      if (!op.empty()) {
+        return VersionConstraint();
+      }
+      op = token;
+      token.clear();
+      continue;
+    }
+    op += token.substr(0, opLength);
+    token = token.substr(opLength);
+
+    uint32_t major;
+    uint32_t minor;
+    if (!parsePattern(token, true, major, minor)) {
+      return VersionConstraint();
+    }
+    token.clear();
+    any = true;
+    std::string compare = op;
+    op.clear();
+
+    // Wildcards turn into the lowest or highest version they cover
+    uint64_t low = (uint64_t(major) << 32) | (minor == anyPart ? 0 : minor);
+    uint64_t high = (uint64_t(major) << 32) | minor;
+
+    if (compare.empty() || compare == "=") {
+      if (major == anyPart) {
+        // X.2 fixes the minor version only, X.X matches anything
+        if (minor != anyPart) {
+          constraint.fixedMinor = true;
+          constraint.minor = minor;
+        }
+        continue;
+      }
+      constraint.lowest = std::max(constraint.lowest, low);
+      constraint.highest = std::min(constraint.highest, high);
+    } else if (major == anyPart) {
+      return VersionConstraint();
+    } else if (compare == ">=") {
+      constraint.lowest = std::max(constraint.lowest, low);
+    } else if (compare == ">") {
+      if (high == std::numeric_limits<uint64_t>::max()) {
+        return VersionConstraint();
+      }
+      constraint.lowest = std::max(constraint.lowest, high + 1);
+    } else if (compare == "<=") {
+      constraint.highest = std::min(constraint.highest, high);
+    } else if (compare == "<") {
+      if (low == 0) {
+        // Nothing is below 0.0, keep it valid but unsatisfiable
+        constraint.lowest = 1;
+        constraint.highest = 0;
+      } else {
+        constraint.highest = std::min(constraint.highest, low - 1);
+      }
+    } else {
+      return VersionConstraint();
+    }
+  }
+
+  constraint.m_valid = any && op.empty();
+  return constraint;
+}
+
+} // namespace BML
@@ -1,61 +1,19 @@
 #include "window.h"
-#include "json.hpp"
 #include "qmarkdowntextedit.h"
 #include "qnamespace.h"
+#include <QBrush>
+#include <QCloseEvent>
 #include <QFileDialog>
 #include <QListWidgetItem>
 #include <QMessageBox>
+#include <QSettings>
 #include <QString>
 #include <QTextStream>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 
-using json = nlohmann::json;
-
 namespace BML {
 
-std::filesystem::path getUserHomeDirectory() {
-  const char *homeDir = std::getenv("HOME"); // For Unix-based systems
-
-  if (homeDir) {
-    return std::filesystem::path(homeDir);
-  } else {
-    // Fallback for Windows
-    homeDir = std::getenv("USERPROFILE");
-    if (homeDir) {
-      return std::filesystem::path(homeDir);
-    } else {
-      // Further fallback if necessary
-      return std::filesystem::path();
-    }
-  }
-}
-
-bool findBorderlandsGameFolder(const std::filesystem::path &startDir,
-                               std::filesystem::path &foundPath) {
-  try {
-    // Check if the start directory exists and is a directory
-    if (!std::filesystem::exists(startDir) ||
-        !std::filesystem::is_directory(startDir)) {
-      return false;
-    }
-
-    // Iterate recursively through the directory
-    for (const auto &entry :
-         std::filesystem::recursive_directory_iterator(startDir)) {
-      if (entry.is_directory() && entry.path().filename() == "Borderlands") {
-        foundPath = entry.path();
-        return true;
-      }
-    }
-  } catch (const std::filesystem::filesystem_error &e) {
-  } catch (const std::exception &e) {
-  }
-
-  return false;
-}
-
 Window::Window(QWidget *parent) : QMainWindow(parent) {
   // Window Settings
   this->setFixedSize(975, 1040);
@@ -75,7 +33,7 @@ Window::Window(QWidget *parent) : QMainWindow(parent) {
 
   // Game Path
   gamePathButton = new QPushButton("...", this);
-  gamePathLine = new QLineEdit("Insert Game Folder Location Here", this);
+  gamePathLine = new QLineEdit(gamePathPlaceholder, this);
   gamePathLabel = new QLabel("Game Folder Location:", this);
 
   gamePathLabel->setGeometry(QRect(QPoint(10, 40), QSize(120, 20)));
@@ -153,11 +111,28 @@ Window::Window(QWidget *parent) : QMainWindow(parent) {
 
   appliedListLabel->setGeometry(QRect(QPoint(765, 65), QSize(200, 15)));
   appliedListLabel->setAlignment(Qt::AlignCenter);
-  appliedList->setGeometry(QRect(QPoint(765, 80), QSize(200, 500)));
+  appliedList->setGeometry(QRect(QPoint(765, 80), QSize(200, 470)));
   appliedList->setDragEnabled(true);
   appliedList->setDragDropMode(QAbstractItemView::InternalMove);
   appliedList->setToolTip("Applied mods list");
 
+  // Save Profile Button
+  saveProfileButton = new QPushButton("Save Profile", this);
+  saveProfileButton->setGeometry(QRect(QPoint(765, 555), QSize(95, 20)));
+  saveProfileButton->setToolTip("Save the active mods list as a profile");
+
+  connect(saveProfileButton, &QPushButton::released, this,
+          &Window::handleSaveProfileButton);
+
+  // Load Profile Button
+  loadProfileButton = new QPushButton("Load Profile", this);
+  loadProfileButton->setGeometry(QRect(QPoint(870, 555), QSize(95, 20)));
+  loadProfileButton->setToolTip(
+      "Replace the active mods list with a saved profile and apply it");
+
+  connect(loadProfileButton, &QPushButton::released, this,
+          &Window::handleLoadProfileButton);
+
   // Search For Mods Button
   searchForModsButton = new QPushButton("Search Mods Folder", this);
   searchForModsButton->setGeometry(QRect(QPoint(520, 590), QSize(200, 20)));
@@ -183,6 +158,28 @@ Window::Window(QWidget *parent) : QMainWindow(parent) {
   connect(compileModsButton, &QPushButton::released, this,
           &Window::handleCompileModsButton);
 
+  // Compile Progress
+  compileProgress = new QProgressBar(this);
+  compileProgress->setGeometry(QRect(QPoint(110, 590), QSize(250, 20)));
+  compileProgress->setToolTip("Install progress");
+  compileProgress->setRange(0, 1);
+  compileProgress->setValue(0);
+
+  // Cancel Button
+  cancelCompileButton = new QPushButton("Cancel", this);
+  cancelCompileButton->setGeometry(QRect(QPoint(370, 590), QSize(60, 20)));
+  cancelCompileButton->setToolTip("Cancel the running installation");
+  cancelCompileButton->setEnabled(false);
+
+  connect(cancelCompileButton, &QPushButton::released, this,
+          &Window::handleCancelCompileButton);
+
+  // Direct Install Checkbox
+  directInstallBox = new QCheckBox("Direct", this);
+  directInstallBox->setGeometry(QRect(QPoint(440, 590), QSize(75, 20)));
+  directInstallBox->setToolTip(
+      "Install straight into the game folder without a staging copy");
+
   // Export Log Button
   exportLogButton = new QPushButton("Export Log", this);
   exportLogButton->setGeometry(QRect(QPoint(10, 590), QSize(90, 20)));
@@ -201,7 +198,31 @@ Window::Window(QWidget *parent) : QMainWindow(parent) {
   log->setToolTip("Logs");
 
   // Compiler
-  compiler = new Compiler(log);
+  compiler = new Compiler(log->backend());
+  compileThread = new CompileThread(compiler, this);
+
+  connect(compileThread, &CompileThread::progress, this,
+          &Window::handleCompileProgress);
+  connect(compileThread, &CompileThread::compiled, this,
+          &Window::handleCompileFinished);
+
+  // Settings
+  settings = new QSettings(
+      QString((std::filesystem::current_path() / "bml.ini").c_str()),
+      QSettings::IniFormat, this);
+
+  // Game Folder Search
+  gameFinder = new GameFinderThread(this);
+
+  connect(gameFinder, &GameFinderThread::found, this,
+          &Window::handleGameFolderFound);
+  connect(gameFinder, &GameFinderThread::notFound, this,
+          &Window::handleGameFolderNotFound);
+
+  // Scan Cache
+  scanCache =
+      new ScanCache(std::filesystem::current_path() / "Cache" / "scan.json");
+  scanCache->load();
 
   log->appendLogMessage(
       "\n******************************************************");
@@ -216,7 +237,18 @@ Window::Window(QWidget *parent) : QMainWindow(parent) {
   std::filesystem::path gameFolder =
       std::filesystem::current_path() / "Borderlands";
 
+  // Folders from the last session, only a stat is needed to trust them
+  std::filesystem::path savedModsFolder =
+      settings->value("modsFolder").toString().toStdString();
+  std::filesystem::path savedGameFolder =
+      settings->value("gameFolder").toString().toStdString();
+
   try {
+    if (!savedModsFolder.empty() &&
+        std::filesystem::is_directory(savedModsFolder)) {
+      modsFolder = savedModsFolder;
+    }
+
     // Check if the directory exists
     if (std::filesystem::exists(modsFolder) &&
         std::filesystem::is_directory(modsFolder)) {
@@ -229,25 +261,22 @@ Window::Window(QWidget *parent) : QMainWindow(parent) {
       }
     }
 
-    if (std::filesystem::exists(gameFolder) &&
-        std::filesystem::is_directory(gameFolder)) {
+    if (!savedGameFolder.empty() &&
+        std::filesystem::is_directory(savedGameFolder)) {
+      log->appendLogMessage("Using saved Game Folder at " +
+                            QString(savedGameFolder.c_str()));
+      gamePathLine->setText(savedGameFolder.c_str());
+    } else if (std::filesystem::exists(gameFolder) &&
+               std::filesystem::is_directory(gameFolder)) {
       log->appendLogMessage("Found Game Folder at " +
                             QString(gameFolder.c_str()));
       gamePathLine->setText(gameFolder.c_str());
+      saveFolders();
     } else {
-      std::filesystem::path startDir =
-          getUserHomeDirectory(); // Set the start directory to the user's
-                                  // home directory
-
-      if (!startDir.empty()) {
-
-        std::filesystem::path foundPath;
-        if (findBorderlandsGameFolder(startDir, foundPath)) {
-          log->appendLogMessage("Found Game Folder at " +
-                                QString(foundPath.c_str()));
-          gamePathLine->setText(foundPath.c_str());
-        }
-      }
+      // Searching the home directory can take a while, do it in the
+      // background and fill in the game folder once found
+      log->appendLogMessage("Searching for Game Folder...");
+      gameFinder->start();
     }
 
   } catch (const std::filesystem::filesystem_error &e) {
@@ -266,6 +295,7 @@ void Window::handleModsFolderButton() {
       QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
   modsPathLine->setText(path);
   handleSearchForModsButton();
+  saveFolders();
 }
 
 void Window::handleGameFolderButton() {
@@ -273,6 +303,32 @@ void Window::handleGameFolderButton() {
       this, tr("Open Directory"), ".",
       QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
   gamePathLine->setText(path);
+  saveFolders();
+}
+
+void Window::handleGameFolderFound(QString path) {
+  // Never override a folder the user picked while the search ran
+  if (gamePathLine->text() != gamePathPlaceholder) {
+    return;
+  }
+  log->appendLogMessage("Found Game Folder at " + path);
+  gamePathLine->setText(path);
+  saveFolders();
+}
+
+void Window::saveFolders() {
+  // Only remember folders that exist, a typo should not stick around
+  if (std::filesystem::is_directory(modsPathLine->text().toStdString())) {
+    settings->setValue("modsFolder", modsPathLine->text());
+  }
+  if (std::filesystem::is_directory(gamePathLine->text().toStdString())) {
+    settings->setValue("gameFolder", gamePathLine->text());
+  }
+}
+
+void Window::handleGameFolderNotFound() {
+  log->appendLogMessage("Could not find the Game Folder, please set its "
+                        "location manually.");
 }
 
 void Window::handleLoadedListSelect() {
@@ -320,16 +376,17 @@ void Window::handleAddModButton() {
       continue;
     }
 
-    QListWidgetItem *tmp = new QListWidgetItem(item->text());
-    tmp->setToolTip(item->toolTip());
-    appliedList->addItem(tmp);
+    const Mod *mod = loadedMods.findPath(item->toolTip().toStdString());
+    if (mod) {
+      addAppliedMod(*mod);
+    }
   }
 }
 
 void Window::handleRemoveModButton() {
 
   for (auto item : appliedList->selectedItems()) {
-    delete item;
+    removeAppliedMod(item);
   }
 }
 
@@ -377,7 +434,7 @@ void Window::handleDownModButton() {
   }
 }
 
-bool Window::loadMod(Mod mod) {
+bool Window::loadMod(const Mod &mod) {
   switch (mod.checkValid()) {
   case 0:
     log->appendLogMessage("-- Mod " + mod.printQString() +
@@ -431,7 +488,7 @@ bool Window::loadMod(Mod mod) {
 void Window::handleSearchForModsButton() {
   loadedList->clear();
   loadedMods.clear();
-  appliedList->clear();
+  clearAppliedMods();
 
   std::filesystem::path modsPath = modsPathLine->text().toStdString();
   log->appendLogMessage("\nSearching for mods at " + modsPathLine->text());
@@ -445,201 +502,281 @@ void Window::handleSearchForModsButton() {
     return;
   }
 
-  for (const auto &entry : std::filesystem::directory_iterator(modsPath)) {
+  // Folders are read in parallel and then reported one by one in order
+  for (auto &result : scanModsFolder(modsPath, scanCache)) {
+    if (!result.found) {
+      continue;
+    }
 
-    if (!std::filesystem::exists(entry.path()) ||
-        !std::filesystem::is_directory(entry.path())) {
+    for (auto &message : result.messages) {
+      log->appendLogMessage(message);
+    }
+    if (!result.valid) {
       continue;
     }
 
-    for (const auto &file : std::filesystem::directory_iterator(entry.path())) {
-      if (!file.is_regular_file() || file.path().filename() != "bml.json") {
-        continue;
-      }
+    Mod &mod = result.mod;
+    if (const Mod *m = loadedMods.find(mod)) {
+      log->appendLogMessage(
+          "-- !! Duplicate mod detected !! This mod is a duplicate of " +
+          m->printQString() + ". Ignoring mod in folder \"" +
+          QString(std::filesystem::path(mod.path()).filename().c_str()) +
+          "\" !!");
+      continue;
+    }
 
-      log->appendLogMessage("\n- Found mod in folder: " +
-                            QString(entry.path().filename().c_str()));
-      std::ifstream f(file.path());
-      if (!f.is_open()) {
-        log->appendLogMessage("-- !! Failed to open bml.json !!");
-        continue;
-      }
+    if (loadMod(mod)) {
+      loadedMods.add(mod);
+    }
+  }
 
-      json data;
-      try {
-        data = json::parse(f);
-        f.close();
-      } catch (const json::parse_error &e) {
-        log->appendLogMessage("-- !! Failed to parse bml.json !! [" +
-                              QString(e.what()) + "]");
-        continue;
-      } catch (const std::exception &e) {
-        log->appendLogMessage("-- !! Failed to parse bml.json !! [" +
-                              QString(e.what()) + "]");
-        continue;
-      }
+  try {
+    scanCache->save();
+  } catch (const std::filesystem::filesystem_error &e) {
+    log->appendLogMessage("- Failed to save scan cache : " +
+                          QString(e.what()));
+  }
 
-      Mod mod = Mod();
+  for (auto &mod : loadedMods.mods()) {
+    QListWidgetItem *item = new QListWidgetItem(mod.print().c_str());
+    item->setToolTip(mod.path().c_str());
+    loadedList->addItem(item);
+  }
+}
 
-      if (data.contains("name") &&
-          data.find("name")->type() == json::value_t::string) {
-        mod.setName(data.find("name").value());
-      } else {
-        log->appendLogMessage("-- !! No valid name in bml.json !!");
-      }
+std::vector<Mod> Window::appliedMods() {
+  std::vector<Mod> modlist;
+  for (int i = 0; i < appliedList->count(); i++) {
+    const Mod *mod = loadedMods.findPath(
+        appliedList->item(i)->data(Qt::UserRole).toString().toStdString());
+    if (mod) {
+      modlist.push_back(*mod);
+    }
+  }
+  return modlist;
+}
 
-      if (data.contains("author") &&
-          data.find("author")->type() == json::value_t::string) {
-        mod.setAuthor(data.find("author").value());
-      } else {
-        log->appendLogMessage("-- !! No valid author in bml.json !!");
-      }
+void Window::addAppliedMod(const Mod &mod) {
+  QListWidgetItem *item = new QListWidgetItem(mod.print().c_str());
+  item->setData(Qt::UserRole, QString(mod.path().c_str()));
+  appliedList->addItem(item);
+  appliedItems[mod.path()] = item;
+  showProblems(appliedCheck.add(mod));
+}
 
-      if (data.contains("version") &&
-          data.find("version")->type() == json::value_t::string) {
-        mod.setVersion(data.find("version").value());
-      } else {
-        log->appendLogMessage("-- !! No valid version in bml.json !!");
-      }
+void Window::removeAppliedMod(QListWidgetItem *item) {
+  std::string path = item->data(Qt::UserRole).toString().toStdString();
+  appliedItems.erase(path);
+  delete item;
+  showProblems(appliedCheck.remove(path));
+}
 
-      mod.setPath(entry.path());
-
-      bool validDeps = true;
-      if (data.contains("dependencies") &&
-          data.find("dependencies")->type() == json::value_t::array) {
-        log->appendLogMessage("-- Adding dependencies");
-
-        for (auto &dep : data.find("dependencies").value()) {
-          Mod depend = Mod();
-
-          if (dep.contains("name") &&
-              dep.find("name")->type() == json::value_t::string) {
-            depend.setName(dep.find("name").value());
-          } else {
-            log->appendLogMessage("--- ! Dependency with no valid name !");
-          }
-
-          if (dep.contains("author") &&
-              dep.find("author")->type() == json::value_t::string) {
-            depend.setAuthor(dep.find("author").value());
-          } else {
-            log->appendLogMessage("--- ! Dependency with no valid author !");
-          }
-
-          if (dep.contains("version") &&
-              dep.find("version")->type() == json::value_t::string) {
-            depend.setVersion(dep.find("version").value());
-          } else {
-            log->appendLogMessage("--- ! Dependency with no valid version !");
-          }
-          if (depend.checkValid() == 0 || depend.checkValid() == 6) {
-            log->appendLogMessage("--- Dependency added: " +
-                                  depend.printQString());
-            mod.dependencies.push_back(depend);
-          } else {
-            log->appendLogMessage("-- !! Broken bml.json dependencies detected "
-                                  "!! Ignoring mod in folder \"" +
-                                  QString(entry.path().filename().c_str()) +
-                                  "\" !!");
-            validDeps = false;
-          }
-        }
-      }
-      if (!validDeps) {
-        continue;
-      }
+void Window::clearAppliedMods() {
+  appliedList->clear();
+  appliedItems.clear();
+  appliedCheck.clear();
+}
 
-      bool validIncompats = true;
-      if (data.contains("incompatibilities") &&
-          data.find("incompatibilities")->type() == json::value_t::array) {
-        log->appendLogMessage("-- Adding incompatibilities");
-
-        for (auto &incompatible : data.find("incompatibilities").value()) {
-          Mod incompat = Mod();
-
-          if (incompatible.contains("name") &&
-              incompatible.find("name")->type() == json::value_t::string) {
-            incompat.setName(incompatible.find("name").value());
-          } else {
-            log->appendLogMessage("--- ! Incompatibility with no valid name !");
-          }
-
-          if (incompatible.contains("author") &&
-              incompatible.find("author")->type() == json::value_t::string) {
-            incompat.setAuthor(incompatible.find("author").value());
-          } else {
-            log->appendLogMessage(
-                "--- ! Incompatibility with no valid author !");
-          }
-
-          if (incompatible.contains("version") &&
-              incompatible.find("version")->type() == json::value_t::string) {
-            incompat.setVersion(incompatible.find("version").value());
-          } else {
-            log->appendLogMessage(
-                "--- ! Incompatibility with no valid version !");
-          }
-          if (incompat.checkValid() == 0 || incompat.checkValid() == 6) {
-            log->appendLogMessage("--- Incompatibility added: " +
-                                  incompat.printQString());
-            mod.incompatibilities.push_back(incompat);
-          } else {
-            log->appendLogMessage(
-                "-- !! Broken bml.json incompatibilities detected "
-                "!! Ignoring mod in folder \"" +
-                QString(entry.path().filename().c_str()) + "\" !!");
-            validIncompats = false;
-          }
-        }
-      }
-      if (!validIncompats) {
-        continue;
-      }
+void Window::showProblems(const std::vector<std::string> &paths) {
+  for (auto &path : paths) {
+    auto item = appliedItems.find(path);
+    if (item == appliedItems.end()) {
+      continue;
+    }
 
-      bool dupe = false;
-      for (auto m : loadedMods) {
-        if (mod.compare(m) == 0) {
-          log->appendLogMessage(
-              "-- !! Duplicate mod detected !! This mod is a duplicate of " +
-              m.printQString() + ". Ignoring mod in folder \"" +
-              QString(entry.path().filename().c_str()) + "\" !!");
-          dupe = true;
-          break;
-        }
-      }
-      if (dupe) {
-        continue;
-      }
+    // Problems are listed under the path when hovering the mod
+    const std::vector<std::string> &problems = appliedCheck.problems(path);
+    QString toolTip(path.c_str());
+    for (auto &problem : problems) {
+      toolTip += "\n!! " + QString(problem.c_str());
+    }
+    item->second->setToolTip(toolTip);
+    item->second->setForeground(problems.empty() ? QBrush()
+                                                 : QBrush(Qt::red));
+  }
+}
 
-      if (loadMod(mod)) {
-        loadedMods.push_back(mod);
-      }
+void Window::handleApplyModsButton() {
+  std::vector<Mod> applied = appliedMods();
+
+  // The applied mods keep the version picked by the user, anything they
+  // depend on that is not applied yet is picked from the loaded mods
+  Resolution resolution = resolveVersions(applied, loadedMods);
+  if (resolution.solved) {
+    for (size_t i = applied.size(); i < resolution.mods.size(); i++) {
+      const Mod &mod = resolution.mods[i];
+      log->appendLogMessage("-- Adding dependency " + mod.printQString());
+      addAppliedMod(mod);
+    }
+    applied = resolution.mods;
+  } else if (resolution.timedOut) {
+    log->appendLogMessage("-- Could not work out the dependencies in time, "
+                          "applying the list as it is");
+  } else {
+    log->appendLogMessage(
+        "!! ERROR !! These mods cannot be installed together:");
+    for (auto &mod : resolution.conflict) {
+      log->appendLogMessage("  - " + mod.printQString());
     }
   }
 
-  for (auto mod : loadedMods) {
-    QListWidgetItem *item = new QListWidgetItem(mod.print().c_str());
-    item->setToolTip(mod.path().c_str());
-    loadedList->addItem(item);
+  compiler->setModList(applied);
+}
+
+void Window::handleSaveProfileButton() {
+  std::filesystem::create_directories(Profile::folder());
+  QString fileName = QFileDialog::getSaveFileName(
+      this, tr("Save Profile"), QString(Profile::folder().c_str()),
+      tr("Profiles (*.json)"));
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  std::filesystem::path file = fileName.toStdString();
+  if (file.extension() != ".json") {
+    file += ".json";
+  }
+
+  Profile profile(file.stem().string(), appliedMods());
+  try {
+    if (!profile.save(file)) {
+      log->appendLogMessage("!! ERROR !! Failed to write profile " +
+                            QString(file.c_str()));
+      return;
+    }
+  } catch (const std::filesystem::filesystem_error &e) {
+    log->appendLogMessage("!! ERROR !! Failed to write profile : " +
+                          QString(e.what()));
+    return;
   }
+  log->appendLogMessage(
+      "\nSaved profile \"" + QString(profile.name.c_str()) + "\" with " +
+      QString(std::to_string(profile.mods.size()).c_str()) + " mods");
 }
 
-void Window::handleApplyModsButton() {
-  std::vector<Mod> modlist;
-  for (int i = 0; i < appliedList->count(); i++) {
-    for (auto &mod : loadedMods) {
-      if (appliedList->item(i)->toolTip().toStdString() == mod.path()) {
-        modlist.push_back(mod);
-        break;
-      }
+void Window::handleLoadProfileButton() {
+  QString fileName = QFileDialog::getOpenFileName(
+      this, tr("Load Profile"), QString(Profile::folder().c_str()),
+      tr("Profiles (*.json)"));
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  Profile profile;
+  if (!profile.load(fileName.toStdString())) {
+    log->appendLogMessage("!! ERROR !! Failed to read profile " + fileName);
+    return;
+  }
+  log->appendLogMessage("\nLoading profile \"" +
+                        QString(profile.name.c_str()) + "\"");
+  if (!profile.savedHash.empty() && profile.savedHash != profile.hash()) {
+    log->appendLogMessage("-- Profile was edited since it was saved");
+  }
+
+  // Mods are read through the scan cache, no rescan of the mods folder
+  std::vector<Mod> missing;
+  std::vector<Mod> mods = profile.resolve(scanCache, missing);
+  for (auto &mod : missing) {
+    log->appendLogMessage("-- !! Mod " + mod.printQString() +
+                          " from the profile was not found !!");
+  }
+  try {
+    scanCache->save();
+  } catch (const std::filesystem::filesystem_error &e) {
+    log->appendLogMessage("- Failed to save scan cache : " +
+                          QString(e.what()));
+  }
+
+  clearAppliedMods();
+  std::vector<Mod> applied;
+  for (auto &mod : mods) {
+    // A scanned copy of the mod wins, mods from another folder still need to
+    // be known to apply them later
+    if (!loadedMods.find(mod)) {
+      loadedMods.add(mod);
+      QListWidgetItem *item = new QListWidgetItem(mod.print().c_str());
+      item->setToolTip(mod.path().c_str());
+      loadedList->addItem(item);
     }
+    applied.push_back(*loadedMods.find(mod));
+    addAppliedMod(applied.back());
   }
-  compiler->setModList(modlist);
+
+  // Installing a profile is a delta against the last install, so switching
+  // between prepared profiles only touches the files that differ
+  compiler->setModList(applied);
 }
 
 void Window::handleCompileModsButton() {
+  if (compileThread->isRunning()) {
+    return;
+  }
+
   compiler->setPath(gamePathLine->text().toStdString());
-  compiler->compile();
+  saveFolders();
+  compiler->setInstallMode(directInstallBox->isChecked()
+                               ? InstallMode::Direct
+                               : InstallMode::Staged);
+
+  // The compiler must not be changed while it runs
+  searchForModsButton->setEnabled(false);
+  applyModsButton->setEnabled(false);
+  loadProfileButton->setEnabled(false);
+  compileModsButton->setEnabled(false);
+  directInstallBox->setEnabled(false);
+  cancelCompileButton->setEnabled(true);
+
+  compileProgress->setRange(0, 0);
+  compileProgress->setFormat("Staging...");
+  compileThread->start();
+}
+
+void Window::handleCancelCompileButton() {
+  log->appendLogMessage("\nCancelling installation...");
+  cancelCompileButton->setEnabled(false);
+  compiler->cancel();
+}
+
+void Window::handleCompileProgress(qulonglong done, qulonglong total,
+                                   qulonglong bytes) {
+  QString megabytes = QString::number(bytes / (1024 * 1024)) + " MB";
+  if (total == 0) {
+    // The number of files is not known yet
+    compileProgress->setRange(0, 0);
+    compileProgress->setFormat(QString::number(done) + " files, " +
+                               megabytes);
+    return;
+  }
+
+  compileProgress->setRange(0, static_cast<int>(total));
+  compileProgress->setValue(static_cast<int>(done));
+  compileProgress->setFormat("%v / %m files, " + megabytes);
+}
+
+void Window::handleCompileFinished(int result) {
+  searchForModsButton->setEnabled(true);
+  applyModsButton->setEnabled(true);
+  loadProfileButton->setEnabled(true);
+  compileModsButton->setEnabled(true);
+  directInstallBox->setEnabled(true);
+  cancelCompileButton->setEnabled(false);
+
+  compileProgress->setRange(0, 1);
+  compileProgress->setValue(result == 0 ? 1 : 0);
+  compileProgress->setFormat(result == 0 ? "Installed" : "Not installed");
+}
+
+void Window::closeEvent(QCloseEvent *event) {
+  // Let an install stop at a consistent point before the window goes away
+  if (compileThread->isRunning()) {
+    compiler->cancel();
+    compileThread->wait();
+  }
+  if (gameFinder->isRunning()) {
+    gameFinder->requestInterruption();
+    gameFinder->wait();
+  }
+  event->accept();
 }
 
 void Window::handleExportLogButton() {
@@ -648,15 +785,11 @@ void Window::handleExportLogButton() {
   log->appendLogMessage("\nExporting log to " + fileName);
 
   if (!fileName.isEmpty()) {
-    QFile file(fileName);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-      QTextStream out(&file);
-      out << log->exportLog(); // Write log content to the file
+    if (log->exportLog(fileName)) {
       log->appendLogMessage("Wrote to " + fileName);
-      file.close();
     } else {
       // Handle the error, e.g., show a message box
-      log->appendLogMessage("Failed to open file " + fileName);
+      log->appendLogMessage("Failed to write file " + fileName);
       QMessageBox::warning(this, tr("Error"),
                            tr("Unable to open file for writing."));
     }